@@ -0,0 +1 @@
+#include "../src/blobstream.h"
@@ -0,0 +1 @@
+#include "../src/compiledquery.h"
@@ -4,6 +4,13 @@ CONFIG += c++11
 
 INCLUDEPATH += $$PWD/include
 DEFINES += NUT_SHARED_POINTER
+
+# Incremental blob I/O of sqlite for BlobStream, QtSql must be built with
+# -system-sqlite so handle of its driver belongs to the linked library
+nut_sqlite_blob {
+    DEFINES += NUT_SQLITE_BLOB
+    LIBS += -lsqlite3
+}
 include(3rdparty/serializer/src/src.pri)
 
 HEADERS += \
@@ -17,6 +24,7 @@ HEADERS += \
     $$PWD/src/defines_p.h \
     $$PWD/src/defines.h \
     $$PWD/src/query.h \
+    $$PWD/src/compiledquery.h \
     $$PWD/src/databasemodel.h \
     $$PWD/src/changelogtable.h \
     $$PWD/src/tablesetbase_p.h \
@@ -29,6 +37,7 @@ HEADERS += \
     $$PWD/src/serializableobject.h \
     $$PWD/src/sqlmodel.h \
     $$PWD/src/sqlmodel_p.h \
+    $$PWD/src/blobstream.h \
     $$PWD/src/phrase.h \
     $$PWD/src/tuple.h \
     $$PWD/src/phrases/conditionalphrase.h \
@@ -41,7 +50,10 @@ HEADERS += \
     $$PWD/src/phrases/assignmentphrase.h \
     $$PWD/src/phrases/numericphrase.h \
     $$PWD/src/phrases/datephrase.h \
-    $$PWD/src/bulkinserter.h
+    $$PWD/src/phrases/parameter.h \
+    $$PWD/src/phrases/aggregatephrase.h \
+    $$PWD/src/bulkinserter.h \
+    $$PWD/src/rowpool_p.h
 
 SOURCES += \
     $$PWD/src/generators/sqlgeneratorbase.cpp \
@@ -61,6 +73,7 @@ SOURCES += \
     $$PWD/src/database.cpp \
     $$PWD/src/serializableobject.cpp \
     $$PWD/src/sqlmodel.cpp \
+    $$PWD/src/blobstream.cpp \
     $$PWD/src/phrase.cpp \
     $$PWD/src/tuple.cpp \
     $$PWD/src/phrases/conditionalphrase.cpp \
@@ -73,4 +86,5 @@ SOURCES += \
     $$PWD/src/phrases/assignmentphrase.cpp \
     $$PWD/src/phrases/numericphrase.cpp \
     $$PWD/src/phrases/datephrase.cpp \
-    $$PWD/src/bulkinserter.cpp
+    $$PWD/src/bulkinserter.cpp \
+    $$PWD/src/rowpool.cpp
@@ -0,0 +1,382 @@
+/**************************************************************************
+**
+** This file is part of Nut project.
+** https://github.com/HamedMasafi/Nut
+**
+** Nut is free software: you can redistribute it and/or modify
+** it under the terms of the GNU Lesser General Public License as published by
+** the Free Software Foundation, either version 3 of the License, or
+** (at your option) any later version.
+**
+** Nut is distributed in the hope that it will be useful,
+** but WITHOUT ANY WARRANTY; without even the implied warranty of
+** MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+** GNU Lesser General Public License for more details.
+**
+** You should have received a copy of the GNU Lesser General Public License
+** along with Nut.  If not, see <http://www.gnu.org/licenses/>.
+**
+**************************************************************************/
+
+#include <QtSql/QSqlDriver>
+#include <QtSql/QSqlError>
+
+#include "blobstream.h"
+#include "database.h"
+#include "databasemodel.h"
+#include "tablemodel.h"
+#include "table.h"
+#include "generators/sqlgeneratorbase_p.h"
+#include "generators/sqlitegenerator.h"
+
+#include <cstring>
+
+#ifdef NUT_SQLITE_BLOB
+#   include <sqlite3.h>
+#endif
+
+#ifndef __NUT_BLOB_CHUNK_SIZE
+#   define __NUT_BLOB_CHUNK_SIZE 1024 * 1024
+#endif
+
+NUT_BEGIN_NAMESPACE
+
+/*!
+ * \class BlobStream
+ * \brief Reads or writes a binary field of one row chunk by chunk.
+ *
+ * Only sqlite is supported, other dialects keep binary values encoded as
+ * text and open() fails for them.
+ *
+ * When Nut is built with NUT_SQLITE_BLOB (qmake CONFIG += nut_sqlite_blob,
+ * QtSql must use the same system sqlite library) the field is read and
+ * written in place by incremental blob I/O of sqlite, so only the chunk
+ * that is read or written is in memory. Writing in place needs the final
+ * size to be reserved before opening (see reserve()), otherwise data is
+ * appended.
+ *
+ * Without it, or for appended data, reading is done by substr() and
+ * writing by appending chunks with ||. Sqlite loads the whole value for
+ * each of these commands and rewrites it for each append, so memory of
+ * database side is not limited and writing is quadratic in size.
+ * \code
+ * BlobStream blob(&db, post, "attachment");
+ * blob.open(QIODevice::ReadOnly);
+ * while (!blob.atEnd())
+ *     file.write(blob.read(64 * 1024));
+ * \endcode
+ */
+BlobStream::BlobStream(Database *database, Table *row, const QString &field,
+                       QObject *parent) : QIODevice(parent),
+    _database(database), _field(field), _key(row->primaryValue()),
+    _size(0), _chunkSize(__NUT_BLOB_CHUNK_SIZE), _reserved(0), _blob(nullptr)
+{
+    init(row->metaObject()->className());
+}
+
+BlobStream::BlobStream(Database *database, const QString &className,
+                       const QVariant &key, const QString &field,
+                       QObject *parent) : QIODevice(parent),
+    _database(database), _field(field), _key(key),
+    _size(0), _chunkSize(__NUT_BLOB_CHUNK_SIZE), _reserved(0), _blob(nullptr)
+{
+    init(className);
+}
+
+BlobStream::~BlobStream()
+{
+    if (isOpen())
+        close();
+}
+
+void BlobStream::init(const QString &className)
+{
+    TableModel *model = _database->model().tableByClassName(className);
+    if (!model) {
+        qWarning("BlobStream: Table for class %s not found",
+                 qPrintable(className));
+        return;
+    }
+
+    _tableName = model->name();
+    _keyField = model->primaryKey();
+}
+
+/*!
+ * \brief BlobStream::open
+ * Opens the stream for reading, or for writing. Written data replaces
+ * current value of field, or is added to end of it when \a mode contains
+ * Append. Opening for both reading and writing is not supported.
+ */
+bool BlobStream::open(OpenMode mode)
+{
+    if (_tableName.isEmpty() || _keyField.isEmpty()) {
+        setErrorString("Table or primary key not found");
+        return false;
+    }
+
+    // Other dialects keep binary values encoded as text
+    if (!_database->sqlGenertor()->supportBinaryParameters()) {
+        setErrorString("Binary streams are not supported by this database");
+        return false;
+    }
+
+    if ((mode & ReadWrite) == ReadWrite) {
+        setErrorString("Blob can not be opened for both reading and writing");
+        return false;
+    }
+
+    _buffer.clear();
+    if ((mode & WriteOnly) && !(mode & Append)) {
+        auto sqlite = dynamic_cast<SqliteGenerator*>(_database->sqlGenertor());
+        bool reserve = _reserved > 0 && sqlite;
+#ifndef NUT_SQLITE_BLOB
+        reserve = false;
+#endif
+        QSqlQuery q = reserve
+                ? exec(sqlite->blobReserve(_tableName, _field, _keyField),
+                       {{":size", _reserved}})
+                : exec(_database->sqlGenertor()->blobClear(
+                           _tableName, _field, _keyField),
+                       {{":chunk", QByteArray("")}});
+        if (q.lastError().isValid()) {
+            setErrorString(q.lastError().text());
+            return false;
+        }
+        _size = 0;
+
+        // Driver without sqlite handle appends data instead
+        if (reserve && !openBlob(true))
+            exec(_database->sqlGenertor()->blobClear(
+                     _tableName, _field, _keyField),
+                 {{":chunk", QByteArray("")}});
+    } else if (!readSize()) {
+        return false;
+    } else if (!(mode & WriteOnly)) {
+        openBlob(false);
+    }
+
+    return QIODevice::open(mode | Unbuffered);
+}
+
+void BlobStream::close()
+{
+    if (_blob) {
+        closeBlob();
+
+        // Unused part of reserved size is removed
+        auto sqlite = dynamic_cast<SqliteGenerator*>(_database->sqlGenertor());
+        if ((openMode() & WriteOnly) && _size < _reserved && sqlite)
+            exec(sqlite->blobTruncate(_tableName, _field, _keyField),
+                 {{":length", _size}});
+    } else if (openMode() & WriteOnly) {
+        flush();
+    }
+    QIODevice::close();
+}
+
+bool BlobStream::isSequential() const
+{
+    return false;
+}
+
+qint64 BlobStream::size() const
+{
+    return _size + _buffer.size();
+}
+
+qint64 BlobStream::bytesAvailable() const
+{
+    return qMax<qint64>(0, _size - pos()) + QIODevice::bytesAvailable();
+}
+
+/*!
+ * \brief BlobStream::flush
+ * Appends written data that is not stored yet to the field
+ */
+bool BlobStream::flush()
+{
+    if (_buffer.isEmpty())
+        return true;
+
+    QSqlQuery q = exec(_database->sqlGenertor()->blobAppend(
+                           _tableName, _field, _keyField),
+                       {{":chunk", _buffer}});
+    if (q.lastError().isValid()) {
+        setErrorString(q.lastError().text());
+        return false;
+    }
+
+    _size += _buffer.size();
+    _buffer.clear();
+    return true;
+}
+
+/*!
+ * \brief BlobStream::chunkSize
+ * \return Maximum size of data that is read by one command, written data
+ * is stored when this size of it is collected
+ */
+int BlobStream::chunkSize() const
+{
+    return _chunkSize;
+}
+
+void BlobStream::setChunkSize(int chunkSize)
+{
+    _chunkSize = qMax(1, chunkSize);
+}
+
+/*!
+ * \brief BlobStream::reservedSize
+ * \return Size that is reserved for written data, zero when data is
+ * appended
+ */
+qint64 BlobStream::reservedSize() const
+{
+    return _reserved;
+}
+
+/*!
+ * \brief BlobStream::reserve
+ * Sets the size of data that will be written, it is used when stream is
+ * opened for writing (without Append). With incremental blob I/O of sqlite
+ * field is filled by zero bytes of this size and written in place, writing
+ * more than reserved size fails and unused part is removed on close.
+ */
+void BlobStream::reserve(qint64 size)
+{
+    _reserved = qMax<qint64>(0, size);
+}
+
+qint64 BlobStream::readData(char *data, qint64 maxSize)
+{
+    qint64 length = qMin(qMin<qint64>(maxSize, _chunkSize), _size - pos());
+    if (length <= 0)
+        return 0;
+
+#ifdef NUT_SQLITE_BLOB
+    if (_blob) {
+        auto blob = static_cast<sqlite3_blob*>(_blob);
+        int rc = sqlite3_blob_read(blob, data, static_cast<int>(length),
+                                   static_cast<int>(pos()));
+        if (rc != SQLITE_OK) {
+            setErrorString(sqlite3_errstr(rc));
+            return -1;
+        }
+        return length;
+    }
+#endif
+
+    QSqlQuery q = exec(_database->sqlGenertor()->blobRead(
+                           _tableName, _field, _keyField),
+                       {{":offset", pos() + 1}, {":length", length}});
+    if (!q.next()) {
+        setErrorString(q.lastError().text());
+        return -1;
+    }
+
+    QByteArray chunk = q.value(0).toByteArray();
+    length = qMin<qint64>(length, chunk.size());
+    memcpy(data, chunk.constData(), static_cast<size_t>(length));
+    return length;
+}
+
+qint64 BlobStream::writeData(const char *data, qint64 maxSize)
+{
+#ifdef NUT_SQLITE_BLOB
+    if (_blob) {
+        if (pos() + maxSize > _reserved) {
+            setErrorString("Written data exceeds reserved size");
+            return -1;
+        }
+
+        auto blob = static_cast<sqlite3_blob*>(_blob);
+        int rc = sqlite3_blob_write(blob, data, static_cast<int>(maxSize),
+                                    static_cast<int>(pos()));
+        if (rc != SQLITE_OK) {
+            setErrorString(sqlite3_errstr(rc));
+            return -1;
+        }
+        _size = qMax(_size, pos() + maxSize);
+        return maxSize;
+    }
+#endif
+
+    _buffer.append(data, static_cast<int>(maxSize));
+    if (_buffer.size() >= _chunkSize && !flush())
+        return -1;
+    return maxSize;
+}
+
+QSqlQuery BlobStream::exec(const QString &sql, QVariantMap binds)
+{
+    binds.insert(":key", _key);
+    return _database->exec(sql, binds);
+}
+
+bool BlobStream::readSize()
+{
+    QSqlQuery q = exec(_database->sqlGenertor()->blobLength(
+                           _tableName, _field, _keyField), QVariantMap());
+    if (!q.next()) {
+        setErrorString(q.lastError().isValid() ? q.lastError().text()
+                                               : QString("Row not found"));
+        return false;
+    }
+
+    _size = q.value(0).toLongLong();
+    return true;
+}
+
+/*
+ * Opens field for incremental blob I/O when Nut is built with it and the
+ * driver gives its sqlite handle, returns false when stream must use
+ * commands instead
+ */
+bool BlobStream::openBlob(bool write)
+{
+#ifdef NUT_SQLITE_BLOB
+    auto sqlite = dynamic_cast<SqliteGenerator*>(_database->sqlGenertor());
+    QVariant handle = _database->database().driver()->handle();
+    if (!sqlite || !handle.isValid() || qstrcmp(handle.typeName(), "sqlite3*"))
+        return false;
+
+    sqlite3 *db = *static_cast<sqlite3 **>(handle.data());
+    if (!db)
+        return false;
+
+    QSqlQuery q = exec(sqlite->blobRowId(_tableName, _keyField), QVariantMap());
+    if (!q.next()) {
+        setErrorString(q.lastError().isValid() ? q.lastError().text()
+                                               : QString("Row not found"));
+        return false;
+    }
+
+    sqlite3_blob *blob = nullptr;
+    int rc = sqlite3_blob_open(db, "main", _tableName.toUtf8().constData(),
+                               _field.toUtf8().constData(),
+                               q.value(0).toLongLong(), write ? 1 : 0, &blob);
+    if (rc != SQLITE_OK) {
+        setErrorString(sqlite3_errmsg(db));
+        sqlite3_blob_close(blob);
+        return false;
+    }
+
+    _blob = blob;
+    return true;
+#else
+    Q_UNUSED(write);
+    return false;
+#endif
+}
+
+void BlobStream::closeBlob()
+{
+#ifdef NUT_SQLITE_BLOB
+    sqlite3_blob_close(static_cast<sqlite3_blob*>(_blob));
+#endif
+    _blob = nullptr;
+}
+
+NUT_END_NAMESPACE
@@ -0,0 +1,85 @@
+/**************************************************************************
+**
+** This file is part of Nut project.
+** https://github.com/HamedMasafi/Nut
+**
+** Nut is free software: you can redistribute it and/or modify
+** it under the terms of the GNU Lesser General Public License as published by
+** the Free Software Foundation, either version 3 of the License, or
+** (at your option) any later version.
+**
+** Nut is distributed in the hope that it will be useful,
+** but WITHOUT ANY WARRANTY; without even the implied warranty of
+** MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+** GNU Lesser General Public License for more details.
+**
+** You should have received a copy of the GNU Lesser General Public License
+** along with Nut.  If not, see <http://www.gnu.org/licenses/>.
+**
+**************************************************************************/
+
+#ifndef BLOBSTREAM_H
+#define BLOBSTREAM_H
+
+#include <QtCore/QIODevice>
+#include <QtCore/QVariant>
+#include <QtSql/QSqlQuery>
+
+#include "defines.h"
+
+NUT_BEGIN_NAMESPACE
+
+class Database;
+class Table;
+class NUT_EXPORT BlobStream : public QIODevice
+{
+    Q_OBJECT
+
+    Database *_database;
+    QString _tableName;
+    QString _keyField;
+    QString _field;
+    QVariant _key;
+    qint64 _size;
+    int _chunkSize;
+    QByteArray _buffer;
+    qint64 _reserved;
+    void *_blob;
+
+public:
+    BlobStream(Database *database, Table *row, const QString &field,
+               QObject *parent = nullptr);
+    BlobStream(Database *database, const QString &className,
+               const QVariant &key, const QString &field,
+               QObject *parent = nullptr);
+    ~BlobStream();
+
+    bool open(OpenMode mode) override;
+    void close() override;
+    bool isSequential() const override;
+    qint64 size() const override;
+    qint64 bytesAvailable() const override;
+
+    bool flush();
+
+    int chunkSize() const;
+    void setChunkSize(int chunkSize);
+
+    qint64 reservedSize() const;
+    void reserve(qint64 size);
+
+protected:
+    qint64 readData(char *data, qint64 maxSize) override;
+    qint64 writeData(const char *data, qint64 maxSize) override;
+
+private:
+    void init(const QString &className);
+    QSqlQuery exec(const QString &sql, QVariantMap binds);
+    bool readSize();
+    bool openBlob(bool write);
+    void closeBlob();
+};
+
+NUT_END_NAMESPACE
+
+#endif // BLOBSTREAM_H
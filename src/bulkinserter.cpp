@@ -3,6 +3,7 @@
 #include "database.h"
 #include "generators/sqlgeneratorbase_p.h"
 #include "databasemodel.h"
+#include "tablemodel.h"
 
 #include <QDebug>
 
@@ -36,8 +37,33 @@ void Nut::BulkInserter::insert(std::initializer_list<QVariant> vars)
 
 int Nut::BulkInserter::apply()
 {
-    auto sql = _database->sqlGenertor()->insertBulk(_className, _fields, variants);
-    QSqlQuery q = _database->exec(sql);
-    return q.numRowsAffected();
+    QStringList returning;
+    TableModel *model = _database->model().tableByName(_className);
+    if (model && model->isPrimaryKeyAutoIncrement())
+        returning.append(model->primaryKey());
+
+    QVariantMap binds;
+    auto sql = _database->sqlGenertor()->insertBulk(_className, _fields,
+                                                    variants, returning,
+                                                    &binds);
+    QSqlQuery q = _database->exec(sql, binds);
+
+    _generatedKeys.clear();
+    if (!q.isSelect())
+        return q.numRowsAffected();
+
+    while (q.next())
+        _generatedKeys.append(q.value(0));
+    return _generatedKeys.count();
+}
+
+/*!
+ * \brief BulkInserter::generatedKeys
+ * \return Auto increment keys of the rows inserted by last call of apply,
+ * as returned by database. Only filled if the sql generator supports RETURNING
+ */
+QVariantList Nut::BulkInserter::generatedKeys() const
+{
+    return _generatedKeys;
 }
 
@@ -17,6 +17,7 @@ class BulkInserter
     QString _className;
     Nut::PhraseList _fields;
     QList<QVariantList> variants;
+    QVariantList _generatedKeys;
     size_t _fieldCount;
 
 public:
@@ -29,6 +30,8 @@ public:
         insert({args...});
     }
     int apply();
+
+    QVariantList generatedKeys() const;
 };
 
 NUT_END_NAMESPACE
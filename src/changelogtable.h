@@ -37,6 +37,10 @@ class ChangeLogTable : public Table
 
     NUT_DECLARE_FIELD(int, version, version, setVersion)
 
+    NUT_LEN(hash, 40)
+    NUT_INDEX(ix_change_logs_hash, hash, asc)
+    NUT_DECLARE_FIELD(QString, hash, hash, setHash)
+
 public:
     explicit ChangeLogTable(QObject *parentTableSet = Q_NULLPTR);
 };
@@ -0,0 +1,153 @@
+/**************************************************************************
+**
+** This file is part of Nut project.
+** https://github.com/HamedMasafi/Nut
+**
+** Nut is free software: you can redistribute it and/or modify
+** it under the terms of the GNU Lesser General Public License as published by
+** the Free Software Foundation, either version 3 of the License, or
+** (at your option) any later version.
+**
+** Nut is distributed in the hope that it will be useful,
+** but WITHOUT ANY WARRANTY; without even the implied warranty of
+** MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+** GNU Lesser General Public License for more details.
+**
+** You should have received a copy of the GNU Lesser General Public License
+** along with Nut.  If not, see <http://www.gnu.org/licenses/>.
+**
+**************************************************************************/
+
+#ifndef COMPILEDQUERY_H
+#define COMPILEDQUERY_H
+
+#include <QtCore/QSharedPointer>
+#include <QtCore/QStringList>
+#include <QtCore/QVariant>
+#include <QtSql/QSqlError>
+#include <QtSql/QSqlQuery>
+
+#include "defines.h"
+#include "database.h"
+#include "phrase.h"
+
+NUT_BEGIN_NAMESPACE
+
+template <class T>
+class Query;
+
+struct RelationModel;
+
+/*
+ * Appends names of parameters of phrase in order they are written to the
+ * command, each name is added once
+ */
+inline void collectParameters(const PhraseData *d, QStringList &names)
+{
+    if (!d)
+        return;
+
+    collectParameters(d->left, names);
+
+    if (d->type == PhraseData::WithVariant) {
+        QVariantList values;
+        if (d->operand.type() == QVariant::List)
+            values = d->operand.toList();
+        else
+            values.append(d->operand);
+
+        foreach (QVariant v, values)
+            if (isParameter(v)) {
+                QString name = v.value<Parameter>().name;
+                if (!names.contains(name))
+                    names.append(name);
+            }
+    }
+
+    collectParameters(d->right, names);
+}
+
+/*!
+ * \brief The CompiledQuery class
+ * Keeps the select command of a query. The command is prepared once per
+ * database connection (and kept by the database until it is closed), each
+ * call only binds arguments, executes and creates the rows. Arguments are bound to parameters declared with Nut::param in order
+ * they appear in the where phrase. Returned rows are not tracked.
+ * \code
+ * auto byId = db.posts()->query()
+ *         ->where(Post::idField() == Nut::param<int>("id"))
+ *         ->compile<int>();
+ * auto posts = byId(&db, 42);
+ * \endcode
+ */
+template <class T, typename... Args>
+class NUT_EXPORT CompiledQuery
+{
+    struct Data {
+        QString sql;
+        QStringList parameters;
+        QString tableName;
+        QList<RelationModel*> relations;
+    };
+    QSharedPointer<Data> d;
+
+public:
+    CompiledQuery() {}
+    CompiledQuery(const QString &sql, const QStringList &parameters,
+                  const QString &tableName,
+                  const QList<RelationModel*> &relations);
+
+    bool isValid() const { return !d.isNull(); }
+    QString sqlCommand() const { return d ? d->sql : QString(); }
+    QStringList parameters() const { return d ? d->parameters : QStringList(); }
+
+    RowList<T> operator()(Database *db, Args... args) const;
+};
+
+template <class T, typename... Args>
+Q_OUTOFLINE_TEMPLATE CompiledQuery<T, Args...>::CompiledQuery(
+        const QString &sql, const QStringList &parameters,
+        const QString &tableName, const QList<RelationModel *> &relations)
+    : d(new Data)
+{
+    d->sql = sql;
+    d->parameters = parameters;
+    d->tableName = tableName;
+    d->relations = relations;
+
+    if (static_cast<int>(sizeof...(Args)) != parameters.count())
+        qWarning("Compiled query has %d parameter(s) but %d argument type(s)",
+                 parameters.count(), static_cast<int>(sizeof...(Args)));
+}
+
+template <class T, typename... Args>
+Q_OUTOFLINE_TEMPLATE RowList<T> CompiledQuery<T, Args...>::operator()(
+        Database *db, Args... args) const
+{
+    if (!d)
+        return RowList<T>();
+
+    QSqlQuery q = db->takePreparedQuery(d->sql);
+    if (q.lastError().type() != QSqlError::NoError)
+        return RowList<T>();
+
+    QVariantList values{ QVariant::fromValue(args)... };
+    for (int i = 0; i < values.count() && i < d->parameters.count(); ++i)
+        q.bindValue(":" + d->parameters.at(i), values.at(i));
+
+    if (!q.exec()) {
+        qWarning("%s", qPrintable(q.lastError().text()));
+        return RowList<T>();
+    }
+
+    RowList<T> ret = Query<T>::readRows(q, db, d->tableName, d->relations,
+                                        nullptr, nullptr);
+    q.finish();
+    db->releasePreparedQuery(d->sql, q);
+
+    return ret;
+}
+
+NUT_END_NAMESPACE
+
+#endif // COMPILEDQUERY_H
@@ -23,10 +23,12 @@
 #include <QtCore/QFile>
 #include <QtCore/QJsonDocument>
 #include <QtCore/QJsonObject>
+#include <QtCore/QJsonArray>
 
 #include <QtSql/QSqlDatabase>
 #include <QtSql/QSqlError>
 #include <QtSql/QSqlQuery>
+#include <QtSql/QSqlRecord>
 #include <QtSql/QSqlResult>
 
 #include "database.h"
@@ -41,6 +43,8 @@
 #include "generators/sqlservergenerator.h"
 #include "query.h"
 #include "changelogtable.h"
+#include "tablesetbasedata.h"
+#include "rowpool_p.h"
 
 #include <iostream>
 #include <cstdarg>
@@ -49,6 +53,18 @@
 #   define __CHANGE_LOG_TABLE_NAME "__change_logs"
 #endif
 
+#ifndef __MIGRATION_JOURNAL_TABLE_NAME
+#   define __MIGRATION_JOURNAL_TABLE_NAME "__migration_journal"
+#endif
+
+#ifndef __NUT_MIGRATION_CHUNK_SIZE
+#   define __NUT_MIGRATION_CHUNK_SIZE 1000
+#endif
+
+#ifndef __NUT_SAVE_BATCH_SIZE
+#   define __NUT_SAVE_BATCH_SIZE 500
+#endif
+
 NUT_BEGIN_NAMESPACE
 
 qulonglong DatabasePrivate::lastId = 0;
@@ -56,7 +72,8 @@ QMap<QString, DatabaseModel> DatabasePrivate::allTableMaps;
 
 DatabasePrivate::DatabasePrivate(Database *parent) : q_ptr(parent),
     port(0), sqlGenertor(nullptr), changeLogs(nullptr),
-    isDatabaseNew(false)
+    isDatabaseNew(false), trackOriginalValues(false),
+    migrationChunkSize(__NUT_MIGRATION_CHUNK_SIZE)
 {
 }
 
@@ -125,6 +142,15 @@ bool DatabasePrivate::open(bool update)
 //        return true;
 }
 
+/*
+ * Sqlite rebuilds tables with foreign keys disabled, the pragma has no
+ * effect inside of a transaction
+ */
+static bool isForeignKeysCommand(const QString &command)
+{
+    return command.startsWith("PRAGMA foreign_keys=");
+}
+
 bool DatabasePrivate::updateDatabase()
 {
     Q_Q(Database);
@@ -132,9 +158,37 @@ bool DatabasePrivate::updateDatabase()
     if (!getCurrectScheema())
         return true;
 
+    // Stored model is the one before an interrupted migration, so a matched
+    // fingerprint means there is nothing to do only without a journal
+    bool interrupted = !isDatabaseNew
+            && db.tables().contains(__MIGRATION_JOURNAL_TABLE_NAME);
+    if (!isDatabaseNew && !interrupted
+            && getLastFingerprint() == currentModel.fingerprint()) {
+        qDebug("Databse is up-to-date");
+        return true;
+    }
+
     DatabaseModel last = isDatabaseNew ? DatabaseModel() : getLastScheema();
     DatabaseModel current = currentModel;
 
+    // An interrupted migration is continued before anything else, its
+    // commands lead to the model stored in journal that is then compared
+    // with current model like a stored one
+    if (interrupted) {
+        int step;
+        QStringList commands;
+        DatabaseModel target;
+        if (readJournal(step, commands, target)) {
+            qDebug("Continuing interrupted migration from step %d of %d",
+                   step + 1, commands.count());
+            if (!migrate(commands, step, last, target))
+                return false;
+            last = target;
+        } else {
+            db.exec("DROP TABLE " __MIGRATION_JOURNAL_TABLE_NAME);
+        }
+    }
+
     if (last == current) {
         qDebug("Databse is up-to-date");
         //TODO: crash without this and I don't know why!
@@ -160,6 +214,13 @@ bool DatabasePrivate::updateDatabase()
 
     QStringList sql = sqlGenertor->diff(last, current);
 
+    QString tableName;
+    QString fromTable;
+    foreach (QString s, sql)
+        if (sqlGenertor->isCopyRecords(s, tableName, fromTable)
+                || isForeignKeysCommand(s))
+            return migrate(sql, 0, last, current);
+
     db.transaction();
     foreach (QString s, sql) {
         db.exec(s);
@@ -171,7 +232,7 @@ bool DatabasePrivate::updateDatabase()
             return false;
         }
     }
-    putModelToDatabase();
+    putModelToDatabase(current);
     bool ok = db.commit();
 
     if (db.lastError().type() == QSqlError::NoError) {
@@ -188,6 +249,232 @@ bool DatabasePrivate::updateDatabase()
     return ok;
 }
 
+static QVariant scalar(QSqlDatabase &db, const QString &sql)
+{
+    QSqlQuery q = db.exec(sql);
+    if (q.next())
+        return q.value(0);
+    return QVariant();
+}
+
+/*
+ * Migrations that copy rows of rebuilt tables run their commands one by
+ * one. Rows are copied in chunks ordered by primary key and committed
+ * between chunks, done steps are kept in journal table so an interrupted
+ * migration is continued on next open
+ */
+bool DatabasePrivate::migrate(const QStringList &commands, int step,
+                              const DatabaseModel &last,
+                              const DatabaseModel &target)
+{
+    Q_Q(Database);
+
+    if (step == 0 && !createJournal(commands, target))
+        return false;
+
+    // Foreign keys stay disabled for the whole migration, also when it is
+    // continued, and their previous state is restored at the end
+    QVariant foreignKeys;
+    foreach (QString s, commands)
+        if (isForeignKeysCommand(s)) {
+            foreignKeys = scalar(db, "PRAGMA foreign_keys");
+            db.exec(s);
+            break;
+        }
+    auto restoreForeignKeys = [&]() {
+        if (!foreignKeys.isNull())
+            db.exec("PRAGMA foreign_keys=" + foreignKeys.toString());
+    };
+
+    QString tableName;
+    QString fromTable;
+    for (; step < commands.count(); ++step) {
+        QString s = commands.at(step);
+
+        if (sqlGenertor->isCopyRecords(s, tableName, fromTable)) {
+            if (!copyRecords(s, target, step, commands.count())) {
+                restoreForeignKeys();
+                return false;
+            }
+            db.transaction();
+        } else if (isForeignKeysCommand(s)) {
+            db.exec(s);
+            db.transaction();
+        } else {
+            db.transaction();
+            QSqlQuery query = db.exec(s);
+
+            if (db.lastError().type() != QSqlError::NoError) {
+                qWarning("Error executing sql command `%s`, %s",
+                         qPrintable(s),
+                         db.lastError().text().toLatin1().data());
+                db.rollback();
+                restoreForeignKeys();
+                return false;
+            }
+
+            // Rows of foreign_key_check are references broken by a rebuild
+            while (s.startsWith("PRAGMA foreign_key_check") && query.next())
+                qWarning("Row %s of %s refers to a missing row of %s",
+                         qPrintable(query.value(1).toString()),
+                         qPrintable(query.value(0).toString()),
+                         qPrintable(query.value(2).toString()));
+        }
+
+        db.exec(QString("UPDATE %1 SET step=%2")
+                .arg(__MIGRATION_JOURNAL_TABLE_NAME).arg(step + 1));
+        db.commit();
+        emit q->migrationProgress(step + 1, commands.count(), 0, 0);
+    }
+
+    db.transaction();
+    putModelToDatabase(target);
+    db.exec("DROP TABLE " __MIGRATION_JOURNAL_TABLE_NAME);
+    bool ok = db.commit();
+    restoreForeignKeys();
+
+    if (ok) {
+        q->databaseUpdated(last.version(), target.version());
+        if (!last.count())
+            q->databaseCreated();
+    } else {
+        qWarning("Unable update database, error = %s",
+                 db.lastError().text().toLatin1().data());
+    }
+
+    return ok;
+}
+
+bool DatabasePrivate::readJournal(int &step, QStringList &commands,
+                                  DatabaseModel &target)
+{
+    QSqlQuery q = db.exec("SELECT step, commands, model FROM "
+                          __MIGRATION_JOURNAL_TABLE_NAME);
+    if (!q.next())
+        return false;
+
+    step = q.value(0).toInt();
+    commands.clear();
+    foreach (QJsonValue v, QJsonDocument::fromJson(q.value(1).toByteArray()).array())
+        commands.append(v.toString());
+    target = QJsonDocument::fromJson(q.value(2).toByteArray()).object();
+    return !commands.isEmpty() && target.count();
+}
+
+bool DatabasePrivate::createJournal(const QStringList &commands,
+                                    const DatabaseModel &target)
+{
+    FieldModel step;
+    step.name = "step";
+    step.type = QMetaType::Int;
+
+    FieldModel data;
+    data.name = "commands";
+    data.type = QMetaType::QString;
+
+    FieldModel model;
+    model.name = "model";
+    model.type = QMetaType::QString;
+
+    db.transaction();
+    db.exec(QString("CREATE TABLE %1 (%2, %3, %4)")
+            .arg(__MIGRATION_JOURNAL_TABLE_NAME,
+                 sqlGenertor->fieldDeclare(&step),
+                 sqlGenertor->fieldDeclare(&data),
+                 sqlGenertor->fieldDeclare(&model)));
+
+    QSqlQuery q(db);
+    q.prepare("INSERT INTO " __MIGRATION_JOURNAL_TABLE_NAME
+              " (step, commands, model) VALUES (0, :commands, :model)");
+    q.bindValue(":commands", QString(QJsonDocument(QJsonArray::fromStringList(commands))
+                                     .toJson(QJsonDocument::Compact)));
+    q.bindValue(":model", QString(QJsonDocument(target.toJson())
+                                  .toJson(QJsonDocument::Compact)));
+
+    if (!q.exec()) {
+        qWarning("Unable to create migration journal, %s",
+                 q.lastError().text().toLatin1().data());
+        db.rollback();
+        return false;
+    }
+    return db.commit();
+}
+
+/*
+ * Rows already copied before an interruption are kept, copying continues
+ * after the greatest key of target table
+ */
+bool DatabasePrivate::copyRecords(const QString &command,
+                                  const DatabaseModel &target,
+                                  int step, int stepCount)
+{
+    Q_Q(Database);
+
+    QString tableName;
+    QString fromTable;
+    QStringList fields;
+    QStringList fromFields;
+    sqlGenertor->isCopyRecords(command, tableName, fromTable,
+                               fields, fromFields);
+
+    // Rows of a rebuilt table are copied into a table with temporary name
+    QString modelName = tableName;
+    if (modelName.startsWith(__NUT_REBUILD_TABLE_PREFIX))
+        modelName.remove(0, int(qstrlen(__NUT_REBUILD_TABLE_PREFIX)));
+
+    TableModel *table = target.tableByName(modelName);
+    QString key = table ? table->primaryKey() : QString();
+
+    // Chunks are filtered by the old column the key is copied from, rows
+    // are copied by one command when there is no such column
+    int keyIndex = fields.indexOf(key);
+    QString fromKey;
+    if (keyIndex != -1 && fields.count() == fromFields.count())
+        fromKey = fromFields.at(keyIndex);
+    if (fromKey.isEmpty())
+        key.clear();
+
+    qint64 total = scalar(db, "SELECT COUNT(*) FROM " + fromTable).toLongLong();
+    qint64 copied = scalar(db, "SELECT COUNT(*) FROM " + tableName).toLongLong();
+    QVariant lastKey;
+    if (!key.isEmpty())
+        lastKey = scalar(db, QString("SELECT MAX(%1) FROM %2").arg(key, tableName));
+
+    forever {
+        QString sql = key.isEmpty()
+                ? command
+                : sqlGenertor->copyRecordsChunk(command, fromKey, lastKey,
+                                                migrationChunkSize);
+        db.transaction();
+        QSqlQuery query = db.exec(sql);
+
+        if (db.lastError().type() != QSqlError::NoError) {
+            qWarning("Error executing sql command `%s`, %s",
+                     qPrintable(sql),
+                     db.lastError().text().toLatin1().data());
+            db.rollback();
+            return false;
+        }
+
+        int rows = query.numRowsAffected();
+        query.finish();
+        db.commit();
+
+        if (rows <= 0)
+            break;
+
+        copied += rows;
+        emit q->migrationProgress(step, stepCount, copied, total);
+
+        if (key.isEmpty() || rows < migrationChunkSize)
+            break;
+
+        lastKey = scalar(db, QString("SELECT MAX(%1) FROM %2").arg(key, tableName));
+    }
+
+    return true;
+}
+
 bool DatabasePrivate::getCurrectScheema()
 {
     Q_Q(Database);
@@ -212,34 +499,35 @@ bool DatabasePrivate::getCurrectScheema()
     changeLogs = new TableSet<ChangeLogTable>(q);
 
     for (int i = 0; i < q->metaObject()->classInfoCount(); i++) {
-        QString type;
-        QString name;
-        QString value;
+        QLatin1String type;
+        QLatin1String name;
+        QLatin1String value;
 
-        if (!nutClassInfoString(q->metaObject()->classInfo(i),
-                                type, name, value)) {
+        if (!nutClassInfoParts(q->metaObject()->classInfo(i),
+                               type, name, value)) {
 
             errorMessage = QString("No valid table in %1")
                     .arg(q->metaObject()->classInfo(i).value());
             continue;
         }
-        if (type == __nut_TABLE) {
+        if (type == QLatin1String(__nut_TABLE)) {
             //name: table class name
             //value: table variable name (table name in db)
-            tables.insert(name, value);
+            tables.insert(nutClassInfoText(name), nutClassInfoText(value));
 
-            int typeId = QMetaType::type(name.toLocal8Bit() + "*");
+            int typeId = QMetaType::type(QByteArray(name.data(), name.size()) + "*");
 
             if (!typeId)
-                qFatal("The class %s is not registered with qt meta object", qPrintable(name));
+                qFatal("The class %s is not registered with qt meta object",
+                       qPrintable(nutClassInfoText(name)));
 
-            TableModel *sch = new TableModel(typeId, value);
+            TableModel *sch = new TableModel(typeId, nutClassInfoText(value));
             currentModel.append(sch);
         }
 
-        if (type == __nut_DB_VERSION) {
+        if (type == QLatin1String(__nut_DB_VERSION)) {
             bool ok;
-            int version = value.toInt(&ok);
+            int version = QString(value).toInt(&ok);
             if (!ok)
                 qFatal("NUT_DB_VERSION macro accept version in format 'x'");
             currentModel.setVersion(version);
@@ -268,62 +556,65 @@ bool DatabasePrivate::getCurrectScheema()
                        qPrintable(f->typeName));
         }
 
-        foreach (RelationModel *fk, table->foreignKeys())
+        foreach (RelationModel *fk, table->foreignKeys()) {
             fk->masterTable = currentModel.tableByClassName(fk->masterClassName);
+            if (fk->masterTable)
+                fk->foreignColumn = fk->masterTable->primaryKey();
+        }
     }
 
     allTableMaps.insert(q->metaObject()->className(), currentModel);
     return true;
 }
 
+/*
+ * Reads only data of the last change log, change logs table of databases
+ * created by older versions has no hash column until it is updated
+ */
 DatabaseModel DatabasePrivate::getLastScheema()
 {
-    Row<ChangeLogTable> u = changeLogs->query()
-            ->orderBy(!ChangeLogTable::idField())
-            ->first();
-
-//    DatabaseModel ret(q->metaObject()->className());
-
-    if (u) {
-        QJsonParseError e;
-        QJsonObject json
-            = QJsonDocument::fromJson(u->data().replace("\\\"", "\"").toUtf8(), &e).object();
-
-        DatabaseModel ret = json;
-        return ret;
-        /*
-        foreach (QString key, json.keys()) {
-            TableModel *sch = new TableModel(json.value(key).toObject(), key);
-            ret.append(sch);
-        }*/
-    }
-    return DatabaseModel();
-
-    //    QSqlQuery query = q->exec("select * from __change_logs order by id
-    //    desc limit 1");
-    //    DatabaseModel ret;
-    //    if(query.next()){
-    //        QJsonObject json =
-    //        QJsonDocument::fromJson(query.value("data").toByteArray()).object();
-
-    //        foreach (QString key, json.keys()) {
-    //            TableModel *sch = new TableModel(json.value(key).toObject(),
-    //            key);
-    //            ret.append(sch);
-    //        }
-    //    }
-    //    return ret;
+    QString sql = QString("SELECT data FROM %1 ORDER BY id DESC")
+            .arg(__CHANGE_LOG_TABLE_NAME);
+    sqlGenertor->appendSkipTake(sql, 0, 1);
+
+    QSqlQuery q(db);
+    if (!q.exec(sql) || !q.next())
+        return DatabaseModel();
+
+    QJsonParseError e;
+    QJsonObject json = QJsonDocument::fromJson(
+                q.value(0).toString().replace("\\\"", "\"").toUtf8(), &e).object();
+
+    DatabaseModel ret = json;
+    return ret;
 }
 
-bool DatabasePrivate::putModelToDatabase()
+/*
+ * Reads only hash of the last change log, change logs stored by older
+ * versions have no hash and are compared by their json
+ */
+QString DatabasePrivate::getLastFingerprint()
+{
+    QString sql = QString("SELECT hash FROM %1 ORDER BY id DESC")
+            .arg(__CHANGE_LOG_TABLE_NAME);
+    sqlGenertor->appendSkipTake(sql, 0, 1);
+
+    QSqlQuery q(db);
+    if (!q.exec(sql) || !q.next())
+        return QString();
+    return q.value(0).toString();
+}
+
+bool DatabasePrivate::putModelToDatabase(const DatabaseModel &model)
 {
     Q_Q(Database);
-    DatabaseModel current = currentModel;
+    DatabaseModel current = model;
     /*current.remove(__CHANGE_LOG_TABLE_NAME)*/;
 
     auto changeLog = create<ChangeLogTable>();
     changeLog->setData(QJsonDocument(current.toJson()).toJson(QJsonDocument::Compact));
     changeLog->setVersion(current.version());
+    changeLog->setHash(current.fingerprint());
     changeLogs->append(changeLog);
     q->saveChanges(true);
     changeLog->deleteLater();
@@ -350,6 +641,553 @@ void DatabasePrivate::createChangeLogs()
         db.exec(s);
 }
 
+/*
+ * Saves all changed rows of all table sets (and child table sets of rows)
+ * table by table. Tables are visited in order of their relations, so keys
+ * of new master rows are known before inserting their childs. Rows of a
+ * table are written with one command per batch of rows where possible.
+ */
+int DatabasePrivate::saveChanges(bool cleanUp)
+{
+    QHash<QString, QList<PendingRow> > rows;
+    QHash<Table*, int> collected;
+    QSet<TableSetBase*> visited;
+    foreach (TableSetBase *ts, tableSets)
+        collectRows(ts, rows, collected, visited);
+
+    QStringList order = saveOrder();
+    foreach (QString className, rows.keys())
+        if (!order.contains(className))
+            order.append(className);
+
+    int rowsAffected = 0;
+    foreach (QString className, order) {
+        if (!rows.contains(className))
+            continue;
+
+        TableModel *model = currentModel.tableByClassName(className);
+        if (!model) {
+            qWarning("Model of class %s not found", qPrintable(className));
+            continue;
+        }
+
+        QList<PendingRow> list = rows.value(className);
+        propagateKeys(list);
+        rowsAffected += insertRows(model, list);
+        rowsAffected += updateRows(model, list);
+    }
+
+    // Childs must be removed before their masters
+    for (int i = order.count() - 1; i >= 0; --i) {
+        if (!rows.contains(order.at(i)))
+            continue;
+
+        TableModel *model = currentModel.tableByClassName(order.at(i));
+        if (model)
+            rowsAffected += deleteRows(model, rows.value(order.at(i)));
+    }
+
+    if (cleanUp) {
+#ifndef NUT_SHARED_POINTER
+        QSet<Table*> savedRows;
+        foreach (QList<PendingRow> list, rows)
+            foreach (PendingRow r, list)
+                savedRows.insert(r.table);
+#endif
+        foreach (TableSetBase *ts, tableSets) {
+#ifndef NUT_SHARED_POINTER
+            foreach (Table *t, ts->data->childs)
+                if (savedRows.contains(t))
+                    t->deleteLater();
+#endif
+            ts->data->childs.clear();
+        }
+    }
+
+    return rowsAffected;
+}
+
+/*
+ * Class names of tables, masters are placed before their slaves
+ */
+QStringList DatabasePrivate::saveOrder()
+{
+    if (tablesSaveOrder.count())
+        return tablesSaveOrder;
+
+    QStringList pending;
+    foreach (TableModel *t, currentModel)
+        pending.append(t->className());
+
+    while (pending.count()) {
+        bool found = false;
+        foreach (QString className, pending) {
+            TableModel *t = currentModel.tableByClassName(className);
+            bool ready = true;
+            foreach (RelationModel *r, t->foreignKeys())
+                if (r->masterClassName != className
+                        && pending.contains(r->masterClassName)) {
+                    ready = false;
+                    break;
+                }
+
+            if (ready) {
+                tablesSaveOrder.append(className);
+                pending.removeOne(className);
+                found = true;
+            }
+        }
+
+        if (!found) {
+            qWarning("Circular relation detected between tables: %s",
+                     qPrintable(pending.join(", ")));
+            tablesSaveOrder.append(pending);
+            break;
+        }
+    }
+
+    return tablesSaveOrder;
+}
+
+void DatabasePrivate::collectRows(TableSetBase *ts,
+                                  QHash<QString, QList<PendingRow> > &rows,
+                                  QHash<Table *, int> &collected,
+                                  QSet<TableSetBase *> &visited)
+{
+    if (visited.contains(ts))
+        return;
+    visited.insert(ts);
+
+    foreach (Row<Table> t, ts->data->childs) {
+        QList<PendingRow> &list = rows[t->metaObject()->className()];
+#ifdef NUT_SHARED_POINTER
+        Table *table = t.data();
+#else
+        Table *table = t;
+#endif
+
+        if (collected.contains(table)) {
+            // A row can be inside a table set of database and a child
+            // table set of its master, the later is needed for keys
+            if (ts->data->table)
+                list[collected.value(table)].tableSet = ts;
+        } else if (t->status() != Table::FeatchedFromDB) {
+            PendingRow r;
+            r.row = t;
+            r.table = table;
+            r.tableSet = ts;
+            collected.insert(table, list.count());
+            list.append(r);
+        }
+
+        foreach (TableSetBase *child, t->d->childTableSets)
+            collectRows(child, rows, collected, visited);
+    }
+}
+
+/*
+ * Sets foreign key of rows inside child table sets to the key of master
+ * row, relation is resolved once per table set
+ */
+void DatabasePrivate::propagateKeys(const QList<PendingRow> &rows)
+{
+    TableSetBase *lastTableSet = nullptr;
+    QByteArray localColumn;
+    QVariant masterKey;
+
+    foreach (PendingRow r, rows) {
+        Table *master = r.tableSet->data->table;
+        if (!master)
+            continue;
+
+        if (r.tableSet != lastTableSet) {
+            lastTableSet = r.tableSet;
+            localColumn.clear();
+
+            QString masterClassName = master->metaObject()->className();
+            TableModel *masterModel = currentModel.tableByClassName(masterClassName);
+            TableModel *model = currentModel.tableByClassName(
+                        r.table->metaObject()->className());
+            if (!masterModel || !model)
+                continue;
+
+            foreach (RelationModel *rel, model->foreignKeys())
+                if (rel->masterClassName == masterClassName) {
+                    localColumn = rel->localColumn.toLatin1();
+                    break;
+                }
+            masterKey = master->property(masterModel->primaryKey().toLatin1().data());
+        }
+
+        if (localColumn.isEmpty() || r.table->status() == Table::Deleted)
+            continue;
+
+        if (r.table->property(localColumn.data()) != masterKey)
+            r.table->setProperty(localColumn.data(), masterKey);
+    }
+}
+
+/*
+ * Changed fields of row without primary key, rows with same bits are
+ * saved in one command
+ */
+static QBitArray changedFieldBits(Table *t, const QString &key, int &keyIndex)
+{
+    QBitArray bits = t->changedPropertyBits();
+    if (keyIndex == -1 && !key.isEmpty())
+        keyIndex = t->metaObject()->indexOfProperty(key.toLatin1().data());
+    if (keyIndex >= 0 && keyIndex < bits.size())
+        bits.clearBit(keyIndex);
+    return bits;
+}
+
+static QList<QMetaProperty> changedFields(Table *t, const QBitArray &bits)
+{
+    QList<QMetaProperty> ret;
+    const QMetaObject *mo = t->metaObject();
+    for (int i = 0; i < bits.size(); ++i)
+        if (bits.testBit(i))
+            ret.append(mo->property(i));
+    return ret;
+}
+
+/*
+ * Text of values of an inserted row, values are written in the same form
+ * that generator sends them to database
+ */
+static QString insertedValuesText(SqlGeneratorBase *generator,
+                                  const QVariantList &values)
+{
+    QStringList ret;
+    foreach (const QVariant &v, values)
+        ret.append(generator->escapeValue(v));
+    return ret.join(", ");
+}
+
+/*
+ * Whether a child table set of row has rows that are not saved, they need
+ * the generated key of row
+ */
+bool DatabasePrivate::hasPendingChilds(Table *t) const
+{
+    foreach (TableSetBase *ts, t->d->childTableSets)
+        foreach (Row<Table> child, ts->data->childs)
+            if (child->status() != Table::FeatchedFromDB)
+                return true;
+    return false;
+}
+
+int DatabasePrivate::saveRow(TableModel *model, Table *t)
+{
+    Q_Q(Database);
+
+    QVariantMap binds;
+    QString sql = sqlGenertor->saveRecord(t, model->name(), &binds);
+    if (sql.isEmpty()) {
+        t->setStatus(Table::FeatchedFromDB);
+        t->clear();
+        return 0;
+    }
+
+    QSqlQuery query = q->exec(sql, binds);
+    int rowsAffected = query.numRowsAffected();
+
+    if (t->status() != Table::Deleted && query.isSelect() && query.next()) {
+        t->loadValues(model, sqlGenertor, query.record());
+        rowsAffected = 1;
+    } else if (t->status() == Table::Added && model->isPrimaryKeyAutoIncrement()) {
+        t->setProperty(model->primaryKey().toLatin1().data(),
+                       query.lastInsertId());
+    }
+
+    t->setStatus(Table::FeatchedFromDB);
+    t->clear();
+    return rowsAffected;
+}
+
+int DatabasePrivate::insertRows(TableModel *model, const QList<PendingRow> &rows)
+{
+    Q_Q(Database);
+
+    QString key = model->isPrimaryKeyAutoIncrement()
+            ? model->primaryKey()
+            : QString();
+
+    // Generated keys of a multi row insert are known only when database
+    // returns the inserted rows
+    int batchSize = key.isEmpty() || sqlGenertor->supportReturning()
+            ? __NUT_SAVE_BATCH_SIZE
+            : 1;
+
+    QStringList returning;
+    if (sqlGenertor->supportReturning())
+        returning = sqlGenertor->returningFields(model);
+
+    // Returned rows of an unordered returning are matched to rows by the
+    // values that were inserted. Rows that need their own key for childs
+    // and rows with same values of other rows are inserted one by one.
+    bool matchValues = !key.isEmpty() && batchSize > 1
+            && !sqlGenertor->supportOrderedReturning();
+
+    QList<QBitArray> groupKeys;
+    QHash<QBitArray, QList<Table*> > groups;
+    QHash<QBitArray, QSet<QString> > groupValues;
+    int keyIndex = -1;
+    int rowsAffected = 0;
+
+    foreach (PendingRow r, rows) {
+        if (r.table->status() != Table::Added)
+            continue;
+
+        QBitArray bits = changedFieldBits(r.table, key, keyIndex);
+        if (batchSize == 1 || !bits.count(true)
+                || (matchValues && hasPendingChilds(r.table))) {
+            rowsAffected += saveRow(model, r.table);
+            continue;
+        }
+
+        if (matchValues) {
+            QVariantList values;
+            foreach (QMetaProperty p, changedFields(r.table, bits))
+                values.append(p.read(r.table));
+            QString text = insertedValuesText(sqlGenertor, values);
+            if (groupValues[bits].contains(text)) {
+                rowsAffected += saveRow(model, r.table);
+                continue;
+            }
+            groupValues[bits].insert(text);
+        }
+
+        if (!groups.contains(bits))
+            groupKeys.append(bits);
+        groups[bits].append(r.table);
+    }
+
+    foreach (QBitArray bits, groupKeys) {
+        QList<Table*> list = groups.value(bits);
+        QList<QMetaProperty> properties = changedFields(list.first(), bits);
+        QStringList fields;
+        QList<FieldModel*> fieldModels;
+        foreach (QMetaProperty p, properties) {
+            fields.append(p.name());
+            fieldModels.append(model->field(p.name()));
+        }
+
+        for (int i = 0; i < list.count(); i += batchSize) {
+            QList<Table*> chunk = list.mid(i, batchSize);
+            if (chunk.count() == 1) {
+                rowsAffected += saveRow(model, chunk.first());
+                continue;
+            }
+
+            QList<QVariantList> vars;
+            QHash<QString, Table*> rowsByValues;
+            foreach (Table *t, chunk) {
+                QVariantList values;
+                foreach (QMetaProperty p, properties)
+                    values.append(p.read(t));
+                vars.append(values);
+                if (matchValues)
+                    rowsByValues.insert(insertedValuesText(sqlGenertor, values), t);
+            }
+
+            QVariantMap binds;
+            QSqlQuery query = q->exec(sqlGenertor->insertRecords(
+                                          model->name(), fields, vars,
+                                          returning, &binds), binds);
+            QSet<Table*> unsaved;
+            if (query.isSelect()) {
+                int n = 0;
+                QStringList unmatchedKeys;
+                while (n < chunk.count() && query.next()) {
+                    ++n;
+                    if (!matchValues) {
+                        chunk.at(n - 1)->loadValues(model, sqlGenertor,
+                                                    query.record());
+                        continue;
+                    }
+
+                    QVariantList values;
+                    for (int j = 0; j < fields.count(); ++j)
+                        values.append(fieldModels.at(j)
+                                      ? sqlGenertor->unescapeValue(
+                                            fieldModels.at(j)->type,
+                                            query.value(fields.at(j)))
+                                      : query.value(fields.at(j)));
+                    Table *t = rowsByValues.take(
+                                insertedValuesText(sqlGenertor, values));
+                    if (t)
+                        t->loadValues(model, sqlGenertor, query.record());
+                    else
+                        unmatchedKeys.append(sqlGenertor->escapeValue(
+                                                 query.value(key)));
+                }
+                rowsAffected += n;
+
+                // Values changed by database (precision, padding, ...) can
+                // not be matched, their records are removed and inserted
+                // again one by one
+                if (rowsByValues.count()) {
+                    int removed = 0;
+                    if (unmatchedKeys.count()) {
+                        QSqlQuery remove = q->exec(sqlGenertor->deleteRecords(
+                                model->name(),
+                                key + " IN (" + unmatchedKeys.join(", ") + ")"));
+                        removed = remove.numRowsAffected();
+                    }
+
+                    if (removed != unmatchedKeys.count()
+                            || unmatchedKeys.count() != rowsByValues.count()) {
+                        qWarning("Unable to save %d rows of %s, inserted rows "
+                                 "could not be matched with returned rows",
+                                 rowsByValues.count(), qPrintable(model->name()));
+                        foreach (Table *t, rowsByValues)
+                            unsaved.insert(t);
+                    } else {
+                        rowsAffected -= removed;
+                        foreach (Table *t, rowsByValues)
+                            rowsAffected += saveRow(model, t);
+                    }
+                }
+            } else {
+                rowsAffected += query.numRowsAffected();
+            }
+
+            foreach (Table *t, chunk) {
+                // Unsaved rows have no key and remain added
+                if (unsaved.contains(t))
+                    continue;
+                t->setStatus(Table::FeatchedFromDB);
+                t->clear();
+            }
+        }
+    }
+
+    return rowsAffected;
+}
+
+int DatabasePrivate::updateRows(TableModel *model, const QList<PendingRow> &rows)
+{
+    Q_Q(Database);
+
+    QString key = model->primaryKey();
+    FieldModel *keyField = model->field(key);
+
+    QStringList returning;
+    if (sqlGenertor->supportReturning())
+        returning = sqlGenertor->returningFields(model);
+
+    QList<QBitArray> groupKeys;
+    QHash<QBitArray, QList<Table*> > groups;
+    int keyIndex = -1;
+    int rowsAffected = 0;
+
+    foreach (PendingRow r, rows) {
+        if (r.table->status() != Table::Modified)
+            continue;
+
+        QBitArray bits = changedFieldBits(r.table, key, keyIndex);
+        if (!bits.count(true) || !keyField) {
+            rowsAffected += saveRow(model, r.table);
+            continue;
+        }
+
+        if (!groups.contains(bits))
+            groupKeys.append(bits);
+        groups[bits].append(r.table);
+    }
+
+    foreach (QBitArray bits, groupKeys) {
+        QList<Table*> list = groups.value(bits);
+        QList<QMetaProperty> properties = changedFields(list.first(), bits);
+        QStringList fields;
+        foreach (QMetaProperty p, properties)
+            fields.append(p.name());
+
+        for (int i = 0; i < list.count(); i += __NUT_SAVE_BATCH_SIZE) {
+            QList<Table*> chunk = list.mid(i, __NUT_SAVE_BATCH_SIZE);
+            if (chunk.count() == 1) {
+                rowsAffected += saveRow(model, chunk.first());
+                continue;
+            }
+
+            QList<QVariantList> vars;
+            QHash<QString, Table*> rowsByKey;
+            foreach (Table *t, chunk) {
+                QVariant keyValue = t->property(key.toLatin1().data());
+                QVariantList values;
+                values.append(keyValue);
+                foreach (QMetaProperty p, properties)
+                    values.append(p.read(t));
+                vars.append(values);
+                rowsByKey.insert(keyValue.toString(), t);
+            }
+
+            QVariantMap binds;
+            QSqlQuery query = q->exec(sqlGenertor->updateRecords(
+                                          model->name(), key, fields, vars,
+                                          returning, &binds), binds);
+            if (query.isSelect()) {
+                int n = 0;
+                while (query.next()) {
+                    QVariant keyValue = sqlGenertor->unescapeValue(
+                                keyField->type, query.value(key));
+                    Table *t = rowsByKey.value(keyValue.toString());
+                    if (t)
+                        t->loadValues(model, sqlGenertor, query.record());
+                    ++n;
+                }
+                rowsAffected += n;
+            } else {
+                rowsAffected += query.numRowsAffected();
+            }
+
+            foreach (Table *t, chunk) {
+                t->setStatus(Table::FeatchedFromDB);
+                t->clear();
+            }
+        }
+    }
+
+    return rowsAffected;
+}
+
+int DatabasePrivate::deleteRows(TableModel *model, const QList<PendingRow> &rows)
+{
+    Q_Q(Database);
+
+    QString key = model->primaryKey();
+    QList<Table*> list;
+    foreach (PendingRow r, rows)
+        if (r.table->status() == Table::Deleted)
+            list.append(r.table);
+
+    int rowsAffected = 0;
+    for (int i = 0; i < list.count(); i += __NUT_SAVE_BATCH_SIZE) {
+        QList<Table*> chunk = list.mid(i, __NUT_SAVE_BATCH_SIZE);
+        if (chunk.count() == 1) {
+            rowsAffected += saveRow(model, chunk.first());
+            continue;
+        }
+
+        QStringList keys;
+        foreach (Table *t, chunk)
+            keys.append(sqlGenertor->escapeValue(t->property(key.toLatin1().data())));
+
+        QSqlQuery query = q->exec(sqlGenertor->deleteRecords(
+                                      model->name(),
+                                      key + " IN (" + keys.join(", ") + ")"));
+        rowsAffected += query.numRowsAffected();
+
+        foreach (Table *t, chunk) {
+            t->setStatus(Table::FeatchedFromDB);
+            t->clear();
+        }
+    }
+
+    return rowsAffected;
+}
+
 /*!
  * \class Database
  * \brief Database class
@@ -393,6 +1231,7 @@ Database::Database(const QSqlDatabase &other)
 Database::~Database()
 {
     Q_D(Database);
+    d->preparedQueries.clear();
     if (d->db.isOpen())
         d->db.close();
 
@@ -506,6 +1345,47 @@ void Database::setDriver(QString driver)
     d->driver = driver.toUpper();
 }
 
+/*!
+ * \brief Database::trackOriginalValues
+ * \return True if rows fetched from database keep their original values
+ * \sa setTrackOriginalValues
+ */
+bool Database::trackOriginalValues() const
+{
+    Q_D(const Database);
+    return d->trackOriginalValues;
+}
+
+/*!
+ * \brief Database::setTrackOriginalValues
+ * When enabled, rows fetched by queries keep a copy of their field values.
+ * Fields set to the value they already have are not counted as changed, so
+ * saveChanges updates only the columns that really changed and skips rows
+ * that did not change at all.
+ */
+void Database::setTrackOriginalValues(bool trackOriginalValues)
+{
+    Q_D(Database);
+    d->trackOriginalValues = trackOriginalValues;
+}
+
+/*!
+ * \brief Database::migrationChunkSize
+ * \return Count of rows copied in each transaction when a migration
+ * rebuilds a table
+ */
+int Database::migrationChunkSize() const
+{
+    Q_D(const Database);
+    return d->migrationChunkSize;
+}
+
+void Database::setMigrationChunkSize(int migrationChunkSize)
+{
+    Q_D(Database);
+    d->migrationChunkSize = qMax(1, migrationChunkSize);
+}
+
 SqlGeneratorBase *Database::sqlGenertor() const
 {
     Q_D(const Database);
@@ -568,12 +1448,14 @@ bool Database::open(bool updateDatabase)
                  driver().toLatin1().constData());
     }
 
+    d->preparedQueries.clear();
     return d->open(updateDatabase);
 }
 
 void Database::close()
 {
     Q_D(Database);
+    d->preparedQueries.clear();
     d->db.close();
 }
 
@@ -586,9 +1468,104 @@ QSqlQuery Database::exec(const QString &sql)
         qWarning("Error executing sql command: %s; Command=%s",
                  d->db.lastError().text().toLatin1().data(),
                  sql.toUtf8().constData());
+    emit commandExecuted(sql);
     return q;
 }
 
+/*!
+ * \brief Database::exec
+ * Executes the command with bound values, values are shared with driver
+ * without converting to text. Command is executed directly when there is
+ * no bound value.
+ */
+QSqlQuery Database::exec(const QString &sql, const QVariantMap &binds)
+{
+    Q_D(Database);
+
+    if (binds.isEmpty())
+        return exec(sql);
+
+    QSqlQuery q(d->db);
+    bool ok = q.prepare(sql);
+    if (ok) {
+        QVariantMap::const_iterator i;
+        for (i = binds.constBegin(); i != binds.constEnd(); ++i)
+            q.bindValue(i.key(), i.value(), QSql::In | QSql::Binary);
+        ok = q.exec();
+    }
+
+    if (!ok)
+        qWarning("Error executing sql command: %s; Command=%s",
+                 q.lastError().text().toLatin1().data(),
+                 sql.toUtf8().constData());
+    emit commandExecuted(sql);
+    return q;
+}
+
+/*!
+ * \brief Database::takePreparedQuery
+ * Returns the command prepared on this connection. A query is prepared
+ * once and taken out of cache while it is used, it should be given back
+ * by releasePreparedQuery after its rows are read. Prepared queries are
+ * dropped when the database is closed.
+ */
+QSqlQuery Database::takePreparedQuery(const QString &sql)
+{
+    Q_D(Database);
+
+    auto it = d->preparedQueries.find(sql);
+    if (it != d->preparedQueries.end()) {
+        QSqlQuery q = it.value();
+        d->preparedQueries.erase(it);
+        return q;
+    }
+
+    QSqlQuery q(d->db);
+    q.setForwardOnly(true);
+    if (!q.prepare(sql))
+        qWarning("Error preparing sql command: %s; Command=%s",
+                 q.lastError().text().toLatin1().data(),
+                 sql.toUtf8().constData());
+    return q;
+}
+
+void Database::releasePreparedQuery(const QString &sql, const QSqlQuery &query)
+{
+    Q_D(Database);
+    if (d->db.isOpen())
+        d->preparedQueries.insert(sql, query);
+}
+
+/*!
+ * \brief Database::isRowPoolEnabled
+ * Returns true if memory of freed rows is kept in current thread to be
+ * reused for next rows.
+ */
+bool Database::isRowPoolEnabled()
+{
+    return RowPool::isEnabled();
+}
+
+/*!
+ * \brief Database::setRowPoolEnabled
+ * Enables or disables keeping memory of freed rows in current thread.
+ * Disabling the pool frees memory that is kept already.
+ */
+void Database::setRowPoolEnabled(bool enabled)
+{
+    RowPool::setEnabled(enabled);
+}
+
+/*!
+ * \brief Database::trimRowPool
+ * Frees all memory of rows that is kept in current thread, e.g. after a
+ * large result is released.
+ */
+void Database::trimRowPool()
+{
+    RowPool::trim();
+}
+
 void Database::add(TableSetBase *t)
 {
     Q_D(Database);
@@ -604,10 +1581,7 @@ int Database::saveChanges(bool cleanUp)
         return 0;
     }
 
-    int rowsAffected = 0;
-    foreach (TableSetBase *ts, d->tableSets)
-        rowsAffected += ts->save(this, cleanUp);
-    return rowsAffected;
+    return d->saveChanges(cleanUp);
 }
 
 void Database::cleanUp()
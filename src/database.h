@@ -23,6 +23,7 @@
 
 #include <QtCore/qglobal.h>
 #include <QtCore/QList>
+#include <QtCore/QVariant>
 #include <QtSql/QSqlDatabase>
 #include <QSharedDataPointer>
 
@@ -55,6 +56,9 @@ public:
     void close();
 
     QSqlQuery exec(const QString& sql);
+    QSqlQuery exec(const QString& sql, const QVariantMap &binds);
+    QSqlQuery takePreparedQuery(const QString &sql);
+    void releasePreparedQuery(const QString &sql, const QSqlQuery &query);
 
     int saveChanges(bool cleanUp = false);
     void cleanUp();
@@ -73,6 +77,21 @@ public:
     SqlGeneratorBase *sqlGenertor() const;
     QSqlDatabase database();
 
+    bool trackOriginalValues() const;
+    void setTrackOriginalValues(bool trackOriginalValues);
+
+    int migrationChunkSize() const;
+    void setMigrationChunkSize(int migrationChunkSize);
+
+    static bool isRowPoolEnabled();
+    static void setRowPoolEnabled(bool enabled);
+    static void trimRowPool();
+
+signals:
+    void migrationProgress(int step, int stepCount,
+                           qint64 copiedRows, qint64 totalRows);
+    void commandExecuted(const QString &sql);
+
 protected:
     //remove minor version
     virtual void databaseCreated();
@@ -26,10 +26,20 @@
 
 #include <QDebug>
 #include <QSharedData>
+#include <QtSql/QSqlQuery>
 
 NUT_BEGIN_NAMESPACE
 
 class ChangeLogTable;
+class SqlGeneratorBase;
+
+struct PendingRow
+{
+    Row<Table> row;
+    Table *table;
+    TableSetBase *tableSet;
+};
+
 class DatabasePrivate //: public QSharedData
 {
     Database *q_ptr;
@@ -41,11 +51,31 @@ public:
     bool open(bool updateDatabase);
 
     bool updateDatabase();
+    bool migrate(const QStringList &commands, int step,
+                 const DatabaseModel &last, const DatabaseModel &target);
+    bool readJournal(int &step, QStringList &commands, DatabaseModel &target);
+    bool copyRecords(const QString &command, const DatabaseModel &target,
+                     int step, int stepCount);
+    bool createJournal(const QStringList &commands,
+                       const DatabaseModel &target);
     void createChangeLogs();
-    bool putModelToDatabase();
+    bool putModelToDatabase(const DatabaseModel &model);
     DatabaseModel getLastScheema();
+    QString getLastFingerprint();
     bool getCurrectScheema();
 
+    int saveChanges(bool cleanUp);
+    QStringList saveOrder();
+    void collectRows(TableSetBase *ts, QHash<QString, QList<PendingRow> > &rows,
+                     QHash<Table *, int> &collected,
+                     QSet<TableSetBase *> &visited);
+    void propagateKeys(const QList<PendingRow> &rows);
+    bool hasPendingChilds(Table *t) const;
+    int saveRow(TableModel *model, Table *t);
+    int insertRows(TableModel *model, const QList<PendingRow> &rows);
+    int updateRows(TableModel *model, const QList<PendingRow> &rows);
+    int deleteRows(TableModel *model, const QList<PendingRow> &rows);
+
     QSqlDatabase db;
 
     QString hostName;
@@ -65,8 +95,15 @@ public:
     static qulonglong lastId;
 
     QSet<TableSetBase *> tableSets;
+    QStringList tablesSaveOrder;
 
     bool isDatabaseNew;
+    bool trackOriginalValues;
+    int migrationChunkSize;
+
+    // Prepared commands of compiled queries, they belong to the connection
+    // and are dropped when it is closed
+    QHash<QString, QSqlQuery> preparedQueries;
 
     QString errorMessage;
 };
@@ -23,6 +23,8 @@
 
 #include <QJsonArray>
 #include <QJsonObject>
+#include <QJsonDocument>
+#include <QCryptographicHash>
 
 NUT_BEGIN_NAMESPACE
 
@@ -37,7 +39,8 @@ DatabaseModel::DatabaseModel(const QString &name) :
 }
 
 DatabaseModel::DatabaseModel(const DatabaseModel &other) :
-    QList<TableModel*>(other), _version(0)
+    QList<TableModel*>(other), _databaseClassName(other._databaseClassName),
+    _version(other._version)
 {
 
 }
@@ -139,6 +142,16 @@ DatabaseModel::operator QJsonObject()
     return toJson();
 }
 
+/*
+ * Hash of json of model, keys of json objects are sorted so same models
+ * have same fingerprints
+ */
+QString DatabaseModel::fingerprint() const
+{
+    QByteArray json = QJsonDocument(toJson()).toJson(QJsonDocument::Compact);
+    return QCryptographicHash::hash(json, QCryptographicHash::Sha1).toHex();
+}
+
 RelationModel *DatabaseModel::relationByClassNames(const QString &masterClassName, const QString &childClassName)
 {
     TableModel *childTable = tableByClassName(childClassName);
@@ -60,6 +60,7 @@ public:
     static DatabaseModel fromJson(QJsonObject &json);
     QJsonObject toJson() const;
     operator QJsonObject();
+    QString fingerprint() const;
 
     int version() const;
     void setVersion(int version);
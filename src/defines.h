@@ -31,6 +31,8 @@
 #include <QVariant>
 #include <QMetaClassInfo>
 
+#include <cstring>
+
 #ifdef NUT_COMPILE_STATIC
 #   define NUT_EXPORT
 #else
@@ -75,11 +77,17 @@ public:                                                                        \
         return f;                                                              \
     }                                                                          \
     type read() const{                                                         \
+        if (Q_UNLIKELY(hasNotLoadedProperties())) {                            \
+            static const int __nut_index =                                     \
+                    staticMetaObject.indexOfProperty(#name);                   \
+            loadProperty(__nut_index);                                         \
+        }                                                                      \
         return m_##name;                                                       \
     }                                                                          \
     void write(type name){                                                     \
+        static const int __nut_index = staticMetaObject.indexOfProperty(#name);\
         m_##name = name;                                                       \
-        propertyChanged(#name);                                                \
+        propertyChanged(__nut_index);                                          \
     }
 
 #define NUT_FOREIGN_KEY(type, keytype, name, read, write)                     \
@@ -106,18 +114,25 @@ public:                                                                        \
     static NUT_WRAP_NAMESPACE(FieldPhrase<keytype>)& name##Id ## Field(){             \
         static NUT_WRAP_NAMESPACE(FieldPhrase<keytype>) f =                       \
                 NUT_WRAP_NAMESPACE(FieldPhrase<keytype>)                          \
-                        (staticMetaObject.className(), #name);                 \
+                        (staticMetaObject.className(), #name "Id");            \
         return f;                                                              \
     }                                                                          \
 public slots: \
     void write(Nut::Row<type> name); \
     void write##Id(keytype name##Id);
 
+// Makes database to keep the relation, onDelete is one of CASCADE,
+// SET_NULL, SET_DEFAULT, RESTRICT or NO_ACTION
+#define NUT_FOREIGN_KEY_CONSTRAINT(name, onDelete)                             \
+    NUT_INFO(__nut_FOREIGN_KEY_CONSTRAINT, name, onDelete)
+
 #define NUT_FOREIGN_KEY_IMPLEMENT(class, type, keytype, name, read, write)                     \
     \
     Nut::Row<type> class::read() const { return m_##name ; }                          \
     void class::write(Nut::Row<type> name){                                           \
-        propertyChanged(QT_STRINGIFY2(name##Id));                                                \
+        static const int __nut_index =                                         \
+                staticMetaObject.indexOfProperty(QT_STRINGIFY2(name##Id));     \
+        propertyChanged(__nut_index);                                          \
         m_##name = name;                                                       \
         m_##name##Id = name->primaryValue().value<keytype>(); \
     } \
@@ -128,10 +143,11 @@ public slots: \
         return m_##name##Id;                                                       \
     }                                                                          \
     void class::write##Id(keytype name##Id){                                                     \
-        propertyChanged(QT_STRINGIFY2(name##Id));                                                \
+        static const int __nut_index =                                         \
+                staticMetaObject.indexOfProperty(QT_STRINGIFY2(name##Id));     \
         m_##name##Id = name##Id;                                                       \
         m_##name = nullptr; \
-        propertyChanged(QT_STRINGIFY2(name##Id));                                                \
+        propertyChanged(__nut_index);                                          \
     }
 
 
@@ -171,10 +187,65 @@ public slots: \
 #define NUT_LEN(field, len)                 NUT_INFO(__nut_LEN, field, len)
 #define NUT_DEFAULT_VALUE(x, n)             NUT_INFO(__nut_DEFAULT_VALUE, x, n)
 #define NUT_NOT_NULL(x)                     NUT_INFO(__nut_NOT_NULL, x, 1)
-#define NUT_INDEX(name, field, order)
+#define NUT_RENAMED_FROM(x, oldName)        NUT_INFO(__nut_RENAMED_FROM, x, oldName)
+
+// Deferred fields are not selected by queries, their values are loaded on
+// first read of the property for all rows fetched by the same query
+#define NUT_DEFERRED(x)                     NUT_INFO(__nut_DEFERRED, x, 0)
+
+// Indexes, fields of composite indexes are separated by comma and each
+// one can be followed by asc or desc, e.g. NUT_COMPOSITE_INDEX(ix, a, b desc)
+#define NUT_INDEX(name, field, order)                                          \
+    Q_CLASSINFO(__nut_NAME_PERFIX __nut_INDEX #name,                           \
+                __nut_INDEX "\n" #name "\n" #field " " #order)
+#define NUT_COMPOSITE_INDEX(name, ...)                                         \
+    Q_CLASSINFO(__nut_NAME_PERFIX __nut_INDEX #name,                           \
+                __nut_INDEX "\n" #name "\n" #__VA_ARGS__)
+#define NUT_UNIQUE_INDEX(name, ...)                                            \
+    Q_CLASSINFO(__nut_NAME_PERFIX __nut_UNIQUE_INDEX #name,                    \
+                __nut_UNIQUE_INDEX "\n" #name "\n" #__VA_ARGS__)
+#define NUT_INDEX_WHERE(name, condition)                                       \
+    Q_CLASSINFO(__nut_NAME_PERFIX __nut_INDEX_WHERE #name,                     \
+                __nut_INDEX_WHERE "\n" #name "\n" condition)
 
 NUT_BEGIN_NAMESPACE
 
+/*
+ * Splits class info of NUT_* macros without allocation, parts point into
+ * string data of meta object
+ */
+inline bool nutClassInfoParts(const QMetaClassInfo &classInfo,
+                              QLatin1String &type, QLatin1String &name,
+                              QLatin1String &value)
+{
+    if (qstrncmp(classInfo.name(), __nut_NAME_PERFIX,
+                 sizeof(__nut_NAME_PERFIX) - 1))
+        return false;
+
+    const char *typeBegin = classInfo.value();
+    const char *nameBegin = strchr(typeBegin, '\n');
+    if (!nameBegin)
+        return false;
+
+    const char *valueBegin = strchr(nameBegin + 1, '\n');
+    if (!valueBegin || strchr(valueBegin + 1, '\n'))
+        return false;
+
+    type = QLatin1String(typeBegin, int(nameBegin - typeBegin));
+    name = QLatin1String(nameBegin + 1, int(valueBegin - nameBegin - 1));
+    value = QLatin1String(valueBegin + 1);
+    return true;
+}
+
+/*
+ * Class infos are UTF-8, names and values of nutClassInfoParts are decoded
+ * by this. Only type tags are compared as Latin-1.
+ */
+inline QString nutClassInfoText(const QLatin1String &part)
+{
+    return QString::fromUtf8(part.data(), part.size());
+}
+
 inline bool nutClassInfo(const QMetaClassInfo &classInfo,
                          QString &type, QString &name, QVariant &value)
 {
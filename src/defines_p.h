@@ -25,6 +25,10 @@
 #define __TYPE                  "type"
 #define __FIELDS                "fields"
 #define __FOREIGN_KEYS          "foreign_keys"
+#define __INDEXES               "indexes"
+
+// Tables rebuilt by migrations are created by this prefix and renamed
+#define __NUT_REBUILD_TABLE_PREFIX "nut_rebuild_"
 #define __nut_FIELD             "field"
 
 #define __nut_NAME_PERFIX       "nut_info::"
@@ -40,8 +44,15 @@
 #define __nut_LEN               "len"
 #define __nut_DEFAULT_VALUE     "def"
 #define __nut_NOT_NULL          "notnull"
+#define __nut_RENAMED_FROM      "renamed_from"
+#define __nut_DEFERRED          "deferred"
+#define __nut_INDEX             "index"
+#define __nut_UNIQUE_INDEX      "unique_index"
+#define __nut_INDEX_WHERE       "index_where"
+#define __nut_WHERE             "where"
 
 #define __nut_FOREIGN_KEY      "foreign_key"
+#define __nut_FOREIGN_KEY_CONSTRAINT "foreign_key_constraint"
 #define __nut_NEW               "new"
 #define __nut_REMOVE            "remove"
 #define __nut_CHANGE            "change"
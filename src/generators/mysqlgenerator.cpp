@@ -356,4 +356,21 @@ void MySqlGenerator::appendSkipTake(QString &sql, int skip, int take)
     }
 }
 
+bool MySqlGenerator::supportPartialIndex()
+{
+    return false;
+}
+
+QString MySqlGenerator::dropIndex(const TableModel *table,
+                                  const IndexModel *index)
+{
+    return QString("DROP INDEX %1 ON %2").arg(index->name, table->name());
+}
+
+QString MySqlGenerator::dropConstraint(const RelationModel *relation)
+{
+    return QString("ALTER TABLE %1 DROP FOREIGN KEY %2")
+            .arg(relation->slaveTable->name(), constraintName(relation));
+}
+
 NUT_END_NAMESPACE
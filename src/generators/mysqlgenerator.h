@@ -39,6 +39,10 @@ public:
     QString createConditionalPhrase(const PhraseData *d) const override;
     void appendSkipTake(QString &sql, int skip, int take) override;
 
+    bool supportPartialIndex() override;
+    QString dropIndex(const TableModel *table, const IndexModel *index) override;
+    QString dropConstraint(const RelationModel *relation) override;
+
 private:
     bool readInsideParentese(QString &text, QString &out);
 };
@@ -77,6 +77,11 @@ PostgreSqlGenerator::PostgreSqlGenerator(Database *parent) : SqlGeneratorBase (p
 
 }
 
+bool PostgreSqlGenerator::supportReturning()
+{
+    return true;
+}
+
 QString PostgreSqlGenerator::fieldType(FieldModel *field)
 {
     QString dbType;
@@ -384,4 +389,18 @@ QString PostgreSqlGenerator::createConditionalPhrase(const PhraseData *d) const
     return SqlGeneratorBase::createConditionalPhrase(d);
 }
 
+QString PostgreSqlGenerator::castPhrase(const QString &value, FieldModel *field)
+{
+    // Postgres resolves CASE of quoted literals as text, and text is not
+    // assignable to other column types
+    if (!field || field->isAutoIncrement)
+        return value;
+
+    QString type = fieldType(field);
+    if (type.isEmpty())
+        return value;
+
+    return QString("CAST(%1 AS %2)").arg(value, type);
+}
+
 NUT_END_NAMESPACE
@@ -36,6 +36,8 @@ public:
 
     QString fieldType(FieldModel *field) override;
 
+    bool supportReturning() override;
+
     QString diff(FieldModel *oldField, FieldModel *newField) override;
 
     // SqlGeneratorBase interface
@@ -46,6 +48,7 @@ public:
     // SqlGeneratorBase interface
 protected:
     QString createConditionalPhrase(const PhraseData *d) const override;
+    QString castPhrase(const QString &value, FieldModel *field) override;
 };
 
 NUT_END_NAMESPACE
@@ -19,12 +19,14 @@
 **************************************************************************/
 
 #include <QDate>
+#include <QMetaProperty>
 #include <QDebug>
 #include <QDateTime>
 #include <QPointF>
 #include <QTime>
 #include <QUuid>
 #include <QVariant>
+#include <QRegularExpression>
 
 #include "sqlgeneratorbase_p.h"
 #include "../database.h"
@@ -68,10 +70,8 @@ bool SqlGeneratorBase::isNumeric(const QMetaType::Type &type)
 }
 
 SqlGeneratorBase::SqlGeneratorBase(Database *parent)
-    : QObject(parent)
+    : QObject(parent), _database(parent)
 {
-    if (parent)
-        _database = parent;
 
     _serializer = new SqlSerializer;
 }
@@ -88,18 +88,73 @@ QString SqlGeneratorBase::createTable(TableModel *table)
     return QString();
 }
 
-QString SqlGeneratorBase::saveRecord(Table *t, QString tableName)
+/*
+ * Copying rows of rebuilt tables, migrations recognize these commands and
+ * run them in chunks ordered by primary key
+ */
+QString SqlGeneratorBase::copyRecords(const QString &tableName,
+                                      const QString &fromTable,
+                                      const QStringList &fields,
+                                      const QStringList &fromFields)
+{
+    return QString("INSERT INTO %1 ( %2 ) SELECT %3 FROM %4")
+            .arg(tableName, fields.join(", "), fromFields.join(", "), fromTable);
+}
+
+QString SqlGeneratorBase::copyRecordsChunk(const QString &copyCommand,
+                                           const QString &key,
+                                           const QVariant &lastKey,
+                                           int take)
+{
+    QString sql = copyCommand;
+    if (!lastKey.isNull())
+        sql.append(QString(" WHERE %1 > %2").arg(key, escapeValue(lastKey)));
+    sql.append(" ORDER BY " + key);
+    appendSkipTake(sql, -1, take);
+    return sql;
+}
+
+bool SqlGeneratorBase::isCopyRecords(const QString &command,
+                                     QString &tableName,
+                                     QString &fromTable) const
+{
+    QStringList fields;
+    QStringList fromFields;
+    return isCopyRecords(command, tableName, fromTable, fields, fromFields);
+}
+
+bool SqlGeneratorBase::isCopyRecords(const QString &command,
+                                     QString &tableName,
+                                     QString &fromTable,
+                                     QStringList &fields,
+                                     QStringList &fromFields) const
+{
+    static const QRegularExpression r(
+                "^INSERT INTO (\\w+) \\( (.+) \\) SELECT (.+) FROM (\\w+)$");
+    QRegularExpressionMatch m = r.match(command);
+    if (!m.hasMatch())
+        return false;
+
+    tableName = m.captured(1);
+    fields = m.captured(2).split(", ");
+    fromFields = m.captured(3).split(", ");
+    fromTable = m.captured(4);
+    return true;
+}
+
+QString SqlGeneratorBase::saveRecord(Table *t, QString tableName,
+                                     QVariantMap *binds)
 {
     Q_ASSERT(!tableName.isEmpty() && !tableName.isNull());
     switch (t->status()) {
     case Table::Added:
-        return insertRecord(t, tableName);
+        return insertRecord(t, tableName, binds);
 
     case Table::Deleted:
         return deleteRecord(t, tableName);
 
     case Table::Modified:
-        return updateRecord(t, tableName);
+        return updateRecord(t, tableName, binds);
 
     case Table::NewCreated:
     case Table::FeatchedFromDB:
@@ -116,6 +171,8 @@ QString SqlGeneratorBase::recordsPhrase(TableModel *table)
 
     QString ret = QString();
     foreach (FieldModel *f, table->fields()) {
+        if (f->isDeferred)
+            continue;
         if (!ret.isEmpty())
             ret.append(", ");
         ret.append(QString("%1.%2 AS \"%1.%2\"").arg(table->name(), f->name));
@@ -123,22 +180,101 @@ QString SqlGeneratorBase::recordsPhrase(TableModel *table)
     return ret;
 }
 
-QString SqlGeneratorBase::insertBulk(const QString &tableName, const PhraseList &ph, const QList<QVariantList> &vars)
+/*
+ * Selects key and the given fields of rows which their key is in keys, used
+ * for loading deferred fields of fetched rows
+ */
+QString SqlGeneratorBase::selectByKeys(const QString &tableName,
+                                       const QString &key,
+                                       const QStringList &fields,
+                                       const QVariantList &keys)
+{
+    QStringList values;
+    foreach (const QVariant &v, keys)
+        values.append(escapeValue(v));
+
+    return QString("SELECT %1, %2 FROM %3 WHERE %1 IN (%4)")
+            .arg(key, fields.join(", "), tableName, values.join(", "));
+}
+
+/*
+ * Commands used by BlobStream, value of the key is bound to :key, read
+ * position and length to :offset (one based) and :length, and the appended
+ * chunk to :chunk
+ */
+QString SqlGeneratorBase::blobLength(const QString &tableName,
+                                     const QString &field, const QString &key)
+{
+    return QString("SELECT LENGTH(%2) FROM %1 WHERE %3 = :key")
+            .arg(tableName, field, key);
+}
+
+QString SqlGeneratorBase::blobRead(const QString &tableName,
+                                   const QString &field, const QString &key)
+{
+    return QString("SELECT SUBSTRING(%2, :offset, :length) FROM %1 WHERE %3 = :key")
+            .arg(tableName, field, key);
+}
+
+QString SqlGeneratorBase::blobAppend(const QString &tableName,
+                                     const QString &field, const QString &key)
+{
+    return QString("UPDATE %1 SET %2 = COALESCE(%2, '') || :chunk WHERE %3 = :key")
+            .arg(tableName, field, key);
+}
+
+QString SqlGeneratorBase::blobClear(const QString &tableName,
+                                    const QString &field, const QString &key)
+{
+    return QString("UPDATE %1 SET %2 = :chunk WHERE %3 = :key")
+            .arg(tableName, field, key);
+}
+
+QString SqlGeneratorBase::insertBulk(const QString &tableName,
+                                     const PhraseList &ph,
+                                     const QList<QVariantList> &vars,
+                                     const QStringList &returning,
+                                     QVariantMap *binds)
+{
+    QStringList fields;
+    foreach (const PhraseData *d, ph.data)
+        fields.append(d->fieldName);
+
+    return insertRecords(tableName, fields, vars, returning, binds);
+}
+
+QString SqlGeneratorBase::insertRecords(const QString &tableName,
+                                        const QStringList &fields,
+                                        const QList<QVariantList> &vars,
+                                        const QStringList &returning,
+                                        QVariantMap *binds)
 {
     QString sql;
     foreach (QVariantList list, vars) {
         QStringList values;
         foreach (QVariant v, list)
-            values.append(escapeValue(v));
+            values.append(valuePhrase(v, binds));
 
         if (!sql.isEmpty())
             sql.append(", ");
         sql.append("(" + values.join(", ") + ")");
     }
-    sql = "INSERT INTO " + tableName + "(" + createFieldPhrase(ph)
-            + ") VALUES" + sql;
 
-    removeTableNames(sql);
+    QString output;
+    QString returningText;
+    if (returning.count() && supportReturning()) {
+        output = outputPhrase(returning);
+        returningText = returningPhrase(returning);
+    }
+
+    sql = "INSERT INTO " + tableName + "(" + fields.join(", ") + ")"
+            + (output.isEmpty() ? "" : " " + output)
+            + " VALUES" + sql
+            + (returningText.isEmpty() ? "" : " " + returningText);
+
+    if (returning.count() && supportReturning())
+        sql = returningCommand(sql, _database->model().tableByName(tableName),
+                               returning);
     return sql;
 }
 
@@ -158,8 +294,31 @@ QStringList SqlGeneratorBase::constraints(TableModel *table)
 
 QString SqlGeneratorBase::relationDeclare(const RelationModel *relation)
 {
-    return QString("FOREIGN KEY (FK_%1) REFERENCES %2(%1)")
-            .arg(relation->localColumn, relation->slaveTable->name());
+    QString sql = QString("CONSTRAINT %1 FOREIGN KEY (%2) REFERENCES %3(%4)")
+            .arg(constraintName(relation), relation->localColumn,
+                 relation->masterTable->name(), relation->foreignColumn);
+
+    if (!relation->onDelete.isEmpty())
+        sql.append(" ON DELETE " + relation->onDelete);
+    return sql;
+}
+
+QString SqlGeneratorBase::constraintName(const RelationModel *relation) const
+{
+    return QString("fk_%1_%2")
+            .arg(relation->slaveTable->name(), relation->localColumn);
+}
+
+QString SqlGeneratorBase::createConstraint(const RelationModel *relation)
+{
+    return QString("ALTER TABLE %1 ADD %2")
+            .arg(relation->slaveTable->name(), relationDeclare(relation));
+}
+
+QString SqlGeneratorBase::dropConstraint(const RelationModel *relation)
+{
+    return QString("ALTER TABLE %1 DROP CONSTRAINT %2")
+            .arg(relation->slaveTable->name(), constraintName(relation));
 }
 
 QStringList SqlGeneratorBase::diff(const DatabaseModel &lastModel,
@@ -169,6 +328,10 @@ QStringList SqlGeneratorBase::diff(const DatabaseModel &lastModel,
 
     DatabaseModel unionModel = lastModel | newModel;
     DatabaseModel::iterator i;
+    QStringList dropIndexes;
+    QStringList createIndexes;
+    QStringList dropRelations;
+    QStringList createRelations;
 
     for (i = unionModel.begin(); i != unionModel.end(); ++i) {
         TableModel *oldTable = lastModel.tableByName((*i)->name());
@@ -177,12 +340,13 @@ QStringList SqlGeneratorBase::diff(const DatabaseModel &lastModel,
         if (!sql.isEmpty())
             ret << sql;
 
-//        QString sqlRel = diffRelation(oldTable, newTable);
-//        if (!sqlRel.isEmpty())
-//            ret << sqlRel;
+        diffIndexes(oldTable, newTable, dropIndexes, createIndexes);
+        diffRelation(oldTable, newTable, dropRelations, createRelations);
     }
 
-    return ret;
+    // Indexes and constraints are dropped before their columns change and
+    // created after all of tables are in their new shape
+    return dropRelations + dropIndexes + ret + createIndexes + createRelations;
 }
 
 QString SqlGeneratorBase::diff(FieldModel *oldField, FieldModel *newField)
@@ -210,7 +374,7 @@ QStringList SqlGeneratorBase::diff(TableModel *oldTable, TableModel *newTable)
         return QStringList();
 
     if (oldTable && newTable)
-        if (*oldTable == *newTable)
+        if (oldTable->isFieldsEqual(*newTable))
             return QStringList();
 
     if (!newTable)
@@ -272,8 +436,8 @@ QStringList SqlGeneratorBase::diff(TableModel *oldTable, TableModel *newTable)
             QString pkCon = primaryKeyConstraint(newTable);
             if (!pkCon.isEmpty())
                 columnSql << pkCon;
-            columnSql << constraints(newTable);
         }
+        columnSql << constraints(newTable);
 
         sql = QString("CREATE TABLE %1 \n(%2)")
                 .arg(newTable->name(), columnSql.join(",\n"));
@@ -282,73 +446,101 @@ QStringList SqlGeneratorBase::diff(TableModel *oldTable, TableModel *newTable)
     return QStringList() << sql;
 }
 
-QStringList SqlGeneratorBase::diffRelation(TableModel *oldTable, TableModel *newTable)
+void SqlGeneratorBase::diffRelation(TableModel *oldTable, TableModel *newTable,
+                                    QStringList &drops, QStringList &creates)
 {
-    QStringList ret;
+    // Constraints of a dropped table are dropped by the table itself
     if (!newTable)
-        return ret;
-
-    QList<QString> relations;
+        return;
 
     if (oldTable)
-        foreach (RelationModel *r, oldTable->foreignKeys())
-            if (!relations.contains(r->localColumn))
-                relations.append(r->localColumn);
+        foreach (RelationModel *r, oldTable->foreignKeys()) {
+            RelationModel *newRel = newTable->foreignKeyByField(r->localColumn);
+            if (r->isConstraint && (!newRel || *newRel != *r))
+                drops.append(dropConstraint(r));
+        }
 
-    foreach (RelationModel *r, newTable->foreignKeys())
-        if (!relations.contains(r->localColumn))
-            relations.append(r->localColumn);
+    foreach (RelationModel *r, newTable->foreignKeys()) {
+        RelationModel *oldRel = oldTable
+                ? oldTable->foreignKeyByField(r->localColumn)
+                : nullptr;
+        if (!r->isConstraint || (oldRel && *oldRel == *r))
+            continue;
 
-    QStringList columnSql;
-    foreach (QString fieldName, relations) {
-        RelationModel *newRelation = newTable->foreignKeyByField(fieldName);
-        RelationModel *oldRelation = nullptr;
-        if (oldTable)
-            oldRelation = oldTable->foreignKeyByField(fieldName);
-
-        QStringList buffer = diff(oldRelation, newRelation);
-        if (!buffer.isEmpty())
-            columnSql << buffer.at(0);
+        if (r->masterTable)
+            creates.append(createConstraint(r));
+        else
+            qWarning("Master table of %s.%s not found, no constraint created",
+                     qPrintable(newTable->name()), qPrintable(r->localColumn));
     }
-
-    if (columnSql.count())
-        ret.append("ALTER TABLE " + newTable->name() + "\n"
-                + columnSql.join(",\n"));
-
-    return ret;
 }
 
 QStringList SqlGeneratorBase::diff(RelationModel *oldRel, RelationModel *newRel)
 {
     QStringList ret;
-    /*
-        CONSTRAINT FK_PersonOrder FOREIGN KEY (PersonID)
-            REFERENCES Persons(PersonID)
-
-        ADD CONSTRAINT FK_%1 FOREIGN KEY (%1) REFERENCES %2(%3)
-
-        return QString("ADD CONSTRAINT FK_%1 FOREIGN KEY (%1) "
-                                 "REFERENCES %2(%3)")
-                         .arg(newRelation->localColumn)
-                         .arg(newRelation->masterTable->name())
-                         .arg(newRelation->foreignColumn);
-    */
-    if (!oldRel)
-        ret.append(QString("ADD CONSTRAINT FK_%1 FOREIGN KEY (%1) "
-                       "REFERENCES %2(%3)")
-                .arg(newRel->localColumn, newRel->masterTable->name(),
-                     newRel->foreignColumn));
-
-    if (!newRel)
-        ret.append(QString("ADD CONSTRAINT FK_%1 FOREIGN KEY (%1) "
-                       "REFERENCES %2(%3)")
-                .arg(oldRel->localColumn, oldRel->masterTable->name(),
-                     oldRel->foreignColumn));
-
-//    if (*oldRel == *newRel)
+
+    if (oldRel && newRel && *oldRel == *newRel)
+        return ret;
+
+    if (oldRel && oldRel->isConstraint)
+        ret.append(dropConstraint(oldRel));
+
+    if (newRel && newRel->isConstraint)
+        ret.append(createConstraint(newRel));
+
     return ret;
 }
 
+void SqlGeneratorBase::diffIndexes(TableModel *oldTable, TableModel *newTable,
+                                   QStringList &drops, QStringList &creates)
+{
+    // Indexes of a dropped table are dropped by the table itself
+    if (!newTable)
+        return;
+
+    if (oldTable)
+        foreach (IndexModel *index, oldTable->indexes()) {
+            IndexModel *newIndex = newTable->index(index->name);
+            if (!newIndex || *newIndex != *index)
+                drops.append(dropIndex(oldTable, index));
+        }
+
+    foreach (IndexModel *index, newTable->indexes()) {
+        IndexModel *oldIndex = oldTable ? oldTable->index(index->name) : nullptr;
+        if (!oldIndex || *oldIndex != *index)
+            creates.append(createIndex(newTable, index));
+    }
+}
+
+QString SqlGeneratorBase::createIndex(const TableModel *table,
+                                      const IndexModel *index)
+{
+    QStringList columns;
+    for (int i = 0; i < index->fields.count(); ++i)
+        columns.append(index->fields.at(i)
+                       + (index->descending.at(i) ? " DESC" : ""));
+
+    QString sql = QString("CREATE %1INDEX %2 ON %3 (%4)")
+            .arg(index->isUnique ? "UNIQUE " : "", index->name,
+                 table->name(), columns.join(", "));
+
+    if (!index->where.isEmpty()) {
+        if (supportPartialIndex())
+            sql.append(" WHERE " + index->where);
+        else
+            qWarning("Partial index %s is not supported by database, "
+                     "it's created on all rows", qPrintable(index->name));
+    }
+    return sql;
+}
+
+QString SqlGeneratorBase::dropIndex(const TableModel *table,
+                                    const IndexModel *index)
+{
+    Q_UNUSED(table)
+    return "DROP INDEX " + index->name;
+}
+
 QString SqlGeneratorBase::join(const QString &mainTable,
                                const QList<RelationModel*> &list,
                                QStringList *order)
@@ -437,7 +629,8 @@ QString SqlGeneratorBase::join(const QStringList &list, QStringList *order)
     return ret;
 }
 
-QString SqlGeneratorBase::insertRecord(Table *t, QString tableName)
+QString SqlGeneratorBase::insertRecord(Table *t, QString tableName,
+                                       QVariantMap *binds)
 {
     QString sql = QString();
     auto model = _database->model().tableByName(tableName);
@@ -445,44 +638,144 @@ QString SqlGeneratorBase::insertRecord(Table *t, QString tableName)
     QString key = model->isPrimaryKeyAutoIncrement() ? model->primaryKey() : QString();
 
     QStringList values;
+    QStringList fields;
 
-    QSet<QString> props = t->changedProperties();
-    QString changedPropertiesText = QString();
-    foreach (QString f, props) {
-        if (f == key)
+    const QMetaObject *mo = t->metaObject();
+    QBitArray props = t->changedPropertyBits();
+    for (int i = 0; i < props.size(); ++i) {
+        if (!props.testBit(i))
             continue;
 
-        values.append(escapeValue(t->property(f.toLatin1().data())));
+        QMetaProperty p = mo->property(i);
+        if (key == p.name())
+            continue;
 
-        if (changedPropertiesText != "")
-            changedPropertiesText.append(", ");
-        changedPropertiesText.append(f);
+        fields.append(p.name());
+        values.append(valuePhrase(p.read(t), binds));
     }
-    sql = QString("INSERT INTO %1 (%2) VALUES (%3)")
-              .arg(tableName, changedPropertiesText, values.join(", "));
+    QString changedPropertiesText = fields.join(", ");
+
+    QString output;
+    QString returning;
+    QStringList returningFieldNames;
+    if (supportReturning()) {
+        returningFieldNames = returningFields(model);
+        output = outputPhrase(returningFieldNames);
+        returning = returningPhrase(returningFieldNames);
+    }
+
+    sql = QString("INSERT INTO %1 (%2)%3 VALUES (%4)%5")
+              .arg(tableName, changedPropertiesText,
+                   output.isEmpty() ? QString() : " " + output,
+                   values.join(", "),
+                   returning.isEmpty() ? QString() : " " + returning);
 
     removeTableNames(sql);
 
+    if (returningFieldNames.count())
+        sql = returningCommand(sql, model, returningFieldNames);
+    return sql;
+}
+
+/*!
+ * \brief SqlGeneratorBase::updateRecords
+ * Creates one update command for many rows of a table. Each item of \a vars
+ * contains value of \a key followed by values of \a fields for one row.
+ * \code
+ * UPDATE post SET title = CASE id WHEN 1 THEN 'a' WHEN 2 THEN 'b' END
+ *      WHERE id IN (1, 2)
+ * \endcode
+ */
+QString SqlGeneratorBase::updateRecords(const QString &tableName,
+                                        const QString &key,
+                                        const QStringList &fields,
+                                        const QList<QVariantList> &vars,
+                                        const QStringList &returning,
+                                        QVariantMap *binds)
+{
+    auto model = _database->model().tableByName(tableName);
+
+    QStringList keys;
+    QStringList cases;
+    for (int i = 0; i < fields.count(); ++i)
+        cases.append(QString());
+
+    foreach (QVariantList row, vars) {
+        QString keyText = escapeValue(row.at(0));
+        keys.append(keyText);
+
+        for (int i = 0; i < fields.count(); ++i)
+            cases[i].append(QString(" WHEN %1 THEN %2")
+                            .arg(keyText, valuePhrase(row.at(i + 1), binds)));
+    }
+
+    QStringList values;
+    for (int i = 0; i < fields.count(); ++i) {
+        QString caseText = "CASE " + key + cases.at(i) + " END";
+        values.append(fields.at(i) + " = "
+                      + castPhrase(caseText, model ? model->field(fields.at(i)) : nullptr));
+    }
+
+    QString output;
+    QString returningText;
+    if (returning.count() && supportReturning()) {
+        output = outputPhrase(returning);
+        returningText = returningPhrase(returning);
+    }
+
+    QString sql = QString("UPDATE %1 SET %2%3 WHERE %4 IN (%5)%6")
+            .arg(tableName, values.join(", "),
+                 output.isEmpty() ? QString() : " " + output,
+                 key, keys.join(", "),
+                 returningText.isEmpty() ? QString() : " " + returningText);
+
+    if (returning.count() && supportReturning())
+        sql = returningCommand(sql, model, returning);
     return sql;
 }
 
-QString SqlGeneratorBase::updateRecord(Table *t, QString tableName)
+QString SqlGeneratorBase::updateRecord(Table *t, QString tableName,
+                                       QVariantMap *binds)
 {
     QString sql = QString();
     auto model = _database->model().tableByName(tableName);
     QString key = model->primaryKey();
     QStringList values;
 
-    foreach (QString f, t->changedProperties())
-        if (f != key)
-            values.append(f + "='" + t->property(f.toLatin1().data()).toString()
-                          + "'");
-    sql = QString("UPDATE %1 SET %2 WHERE %3=%4")
+    const QMetaObject *mo = t->metaObject();
+    QBitArray props = t->changedPropertyBits();
+    for (int i = 0; i < props.size(); ++i) {
+        if (!props.testBit(i))
+            continue;
+
+        QMetaProperty p = mo->property(i);
+        if (key != p.name())
+            values.append(QString(p.name()) + "=" + valuePhrase(p.read(t), binds));
+    }
+
+    // Row is not changed, there is nothing to update
+    if (values.isEmpty())
+        return QString();
+
+    QString output;
+    QString returning;
+    QStringList returningFieldNames;
+    if (supportReturning()) {
+        returningFieldNames = returningFields(model);
+        output = outputPhrase(returningFieldNames);
+        returning = returningPhrase(returningFieldNames);
+    }
+
+    sql = QString("UPDATE %1 SET %2%3 WHERE %4=%5%6")
               .arg(tableName, values.join(", "),
-                   key, t->property(key.toUtf8().data()).toString());
+                   output.isEmpty() ? QString() : " " + output,
+                   key, t->property(key.toUtf8().data()).toString(),
+                   returning.isEmpty() ? QString() : " " + returning);
 
     removeTableNames(sql);
 
+    if (returningFieldNames.count())
+        sql = returningCommand(sql, model, returningFieldNames);
     return sql;
 }
 
@@ -521,6 +814,27 @@ QString SqlGeneratorBase::agregateText(const AgregateType &t,
     return QString(); // never reach
 }
 
+QString SqlGeneratorBase::agregateText(const PhraseData *d) const
+{
+    QString arg = d->left ? createConditionalPhrase(d->left) : QString("*");
+
+    switch (d->operatorCond) {
+    case PhraseData::AgregateCount:
+        return agregateText(Count, arg);
+    case PhraseData::AgregateSum:
+        return agregateText(Sum, arg);
+    case PhraseData::AgregateMin:
+        return agregateText(Min, arg);
+    case PhraseData::AgregateMax:
+        return agregateText(Max, arg);
+    case PhraseData::AgregateAverage:
+        return agregateText(Average, arg);
+    default:
+        break;
+    }
+    return QString();
+}
+
 QString SqlGeneratorBase::fromTableText(const QString &tableName,
                                         QString &joinClassName,
                                         QString &orderBy) const
@@ -567,7 +881,9 @@ QString SqlGeneratorBase::selectCommand(const QString &tableName,
                                         const PhraseList &order,
                                         const QList<RelationModel*> &joins,
                                         const int skip,
-                                        const int take)
+                                        const int take,
+                                        const PhraseList &groupBy,
+                                        const ConditionalPhrase &having)
 {
     Q_UNUSED(skip);
     Q_UNUSED(take);
@@ -599,6 +915,14 @@ QString SqlGeneratorBase::selectCommand(const QString &tableName,
     if (whereText != "")
         sql.append(" WHERE " + whereText);
 
+    QString groupText = createFieldPhrase(groupBy);
+    if (groupText != "")
+        sql.append(" GROUP BY " + groupText);
+
+    QString havingText = createConditionalPhrase(having.data);
+    if (havingText != "")
+        sql.append(" HAVING " + havingText);
+
     if (orderText != "")
         sql.append(" ORDER BY " + orderText);
 
@@ -861,6 +1185,9 @@ QString SqlGeneratorBase::dateTimePartName(const PhraseData::Condition &op) cons
 
 QString SqlGeneratorBase::escapeValue(const QVariant &v) const
 {
+    if (isParameter(v))
+        return ":" + v.value<Parameter>().name;
+
     if (v.type() == QVariant::String && v.toString().isEmpty())
         return "''";
 
@@ -876,12 +1203,83 @@ QString SqlGeneratorBase::escapeValue(const QVariant &v) const
     return "'" + serialized + "'";
 }
 
+/*
+ * Byte arrays are added to binds and a placeholder is returned when binds
+ * is given and dialect supports binary parameters, so buffer is sent to
+ * driver as is instead of an encoded literal. Other values are escaped
+ */
+QString SqlGeneratorBase::valuePhrase(const QVariant &v, QVariantMap *binds)
+{
+    if (!binds || v.userType() != QMetaType::QByteArray
+            || !supportBinaryParameters())
+        return escapeValue(v);
+
+    QString name = QStringLiteral(":nut_bind_%1").arg(binds->count());
+    binds->insert(name, v);
+    return name;
+}
+
 QVariant SqlGeneratorBase::unescapeValue(const QMetaType::Type &type,
                                      const QVariant &dbValue)
 {
+    QVariant value;
+    if (!dbValue.isNull() && unescapeNativeValue(type, dbValue, value))
+        return value;
+
     return _serializer->deserialize(dbValue.toString(), type);
 }
 
+/*
+ * Converts values that driver returns in their own type (numbers, bools,
+ * strings, date and times) without a string round-trip. Returns false for
+ * composite types those are stored as text, like points, polygons, json,
+ * colors and byte arrays, so they are read by serializer
+ */
+bool SqlGeneratorBase::unescapeNativeValue(const QMetaType::Type &type,
+                                           const QVariant &dbValue,
+                                           QVariant &value) const
+{
+    switch (type) {
+    case QMetaType::Short:
+    case QMetaType::UShort:
+    case QMetaType::Int:
+    case QMetaType::UInt:
+    case QMetaType::Long:
+    case QMetaType::ULong:
+    case QMetaType::LongLong:
+    case QMetaType::ULongLong:
+    case QMetaType::Float:
+    case QMetaType::Double:
+        value = dbValue;
+        if (dbValue.userType() == type)
+            return true;
+        return value.convert(type);
+
+    case QMetaType::Bool:
+        if (dbValue.userType() == QMetaType::QString)
+            return false;
+        value = dbValue.toBool();
+        return true;
+
+    case QMetaType::QString:
+        value = dbValue.userType() == QMetaType::QString
+                ? dbValue
+                : QVariant(dbValue.toString());
+        return true;
+
+    case QMetaType::QDate:
+    case QMetaType::QTime:
+    case QMetaType::QDateTime:
+        if (dbValue.userType() != type)
+            return false;
+        value = dbValue;
+        return true;
+
+    default:
+        return false;
+    }
+}
+
 QString SqlGeneratorBase::phrase(const PhraseData *d) const
 {
     QString ret = QString();
@@ -990,6 +1388,52 @@ QString SqlGeneratorBase::primaryKeyConstraint(const TableModel *table) const
             .arg(table->name(), table->primaryKey());
 }
 
+QString SqlGeneratorBase::returningPhrase(const QStringList &fields) const
+{
+    if (!fields.count())
+        return QString();
+    return "RETURNING " + fields.join(", ");
+}
+
+QString SqlGeneratorBase::outputPhrase(const QStringList &fields) const
+{
+    Q_UNUSED(fields);
+    return QString();
+}
+
+/*
+ * Wraps an insert or update command that returns stored rows, when
+ * database needs more than a clause to return them
+ */
+QString SqlGeneratorBase::returningCommand(const QString &command,
+                                           TableModel *table,
+                                           const QStringList &fields)
+{
+    Q_UNUSED(table);
+    Q_UNUSED(fields);
+    return command;
+}
+
+/*
+ * Fields that are read back by returning, deferred fields are not read
+ * like selects
+ */
+QStringList SqlGeneratorBase::returningFields(const TableModel *table)
+{
+    QStringList ret;
+    if (table)
+        foreach (FieldModel *f, table->fields())
+            if (!f->isDeferred)
+                ret.append(f->name);
+    return ret;
+}
+
+QString SqlGeneratorBase::castPhrase(const QString &value, FieldModel *field)
+{
+    Q_UNUSED(field);
+    return value;
+}
+
 QString SqlGeneratorBase::createConditionalPhrase(const PhraseData *d) const
 {
     if (!d)
@@ -1050,6 +1494,13 @@ QString SqlGeneratorBase::createConditionalPhrase(const PhraseData *d) const
         else if (op == PhraseData::DatePartMilisecond)
             ret = QString("DATEPART(milisecond, %1)")
                     .arg(d->operand.toString());
+        else if (d->left && d->left->operatorCond >= PhraseData::AgregateCount
+                 && d->left->operatorCond <= PhraseData::AgregateAverage
+                 && d->operand.canConvert<double>()
+                 && d->operand.type() != QVariant::String)
+            // aggregates have no column affinity, so numbers are not quoted
+            ret = createConditionalPhrase(d->left) + " " + operatorString(op) + " "
+              + d->operand.toString();
         else
             ret = createConditionalPhrase(d->left) + " " + operatorString(op) + " "
               + escapeValue(d->operand);
@@ -1061,7 +1512,10 @@ QString SqlGeneratorBase::createConditionalPhrase(const PhraseData *d) const
         break;
 
     case PhraseData::WithoutOperand:
-        ret = createConditionalPhrase(d->left) + " " + operatorString(op);
+        if (op >= PhraseData::AgregateCount && op <= PhraseData::AgregateAverage)
+            ret = agregateText(d);
+        else
+            ret = createConditionalPhrase(d->left) + " " + operatorString(op);
         break;
     }
 
@@ -1091,7 +1545,10 @@ QString SqlGeneratorBase::createFieldPhrase(const PhraseList &ph)
     foreach (const PhraseData *d, ph.data) {
         if (ret != "")
             ret.append(", ");
-        ret.append(d->toString());
+        if (d->type == PhraseData::Field)
+            ret.append(d->toString());
+        else
+            ret.append(createConditionalPhrase(d));
         if (d->isNot)
             qDebug() << "Operator ! is ignored in fields phrase";
     }
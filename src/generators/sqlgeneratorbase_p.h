@@ -37,6 +37,7 @@ class DatabaseModel;
 class TableModel;
 class Database;
 struct RelationModel;
+struct IndexModel;
 class SqlGeneratorBase : public QObject
 {
 //    Q_OBJECT
@@ -76,38 +77,107 @@ public:
         Q_UNUSED(type)
         return true;
     }
+    virtual bool supportReturning() {
+        return false;
+    }
+    // Rows returned by a multi row insert are in order of its values
+    virtual bool supportOrderedReturning() {
+        return false;
+    }
+    virtual bool supportPartialIndex() {
+        return true;
+    }
+    virtual bool supportBinaryParameters() {
+        return false;
+    }
 
     //fields
     virtual QString fieldType(FieldModel *field) = 0;
     virtual QString fieldDeclare(FieldModel *field);
     virtual QStringList constraints(TableModel *table);
     virtual QString escapeValue(const QVariant &v) const;
+    QString valuePhrase(const QVariant &v, QVariantMap *binds);
     virtual QVariant unescapeValue(const QMetaType::Type &type, const QVariant &dbValue);
+    virtual bool unescapeNativeValue(const QMetaType::Type &type,
+                                     const QVariant &dbValue,
+                                     QVariant &value) const;
 
     virtual QString masterDatabaseName(QString databaseName);
 
     virtual QString createTable(TableModel *table);
 
     virtual QString relationDeclare(const RelationModel *relation);
+    virtual QString createConstraint(const RelationModel *relation);
+    virtual QString dropConstraint(const RelationModel *relation);
+    QString constraintName(const RelationModel *relation) const;
 
     virtual QStringList diff(const DatabaseModel &lastModel, const DatabaseModel &newModel);
     virtual QString diff(FieldModel *oldField, FieldModel *newField);
     virtual QStringList diff(TableModel *oldTable, TableModel *newTable);
-    virtual QStringList diffRelation(TableModel *oldTable, TableModel *newTable);
+    virtual void diffRelation(TableModel *oldTable, TableModel *newTable,
+                              QStringList &drops, QStringList &creates);
     virtual QStringList diff(RelationModel *oldRel, RelationModel *newRel);
+    virtual void diffIndexes(TableModel *oldTable, TableModel *newTable,
+                             QStringList &drops, QStringList &creates);
+
+    virtual QString createIndex(const TableModel *table, const IndexModel *index);
+    virtual QString dropIndex(const TableModel *table, const IndexModel *index);
 
     virtual QString join(const QString &mainTable,
                          const QList<RelationModel*> &list,
                          QStringList *order = Q_NULLPTR);
     virtual QString join(const QStringList &list, QStringList *order = Q_NULLPTR);
 
-    virtual QString saveRecord(Table *t, QString tableName);
+    virtual QString saveRecord(Table *t, QString tableName,
+                               QVariantMap *binds = nullptr);
+
+    virtual QString copyRecords(const QString &tableName,
+                                const QString &fromTable,
+                                const QStringList &fields,
+                                const QStringList &fromFields);
+    virtual QString copyRecordsChunk(const QString &copyCommand,
+                                     const QString &key,
+                                     const QVariant &lastKey,
+                                     int take);
+    bool isCopyRecords(const QString &command, QString &tableName,
+                       QString &fromTable) const;
+    bool isCopyRecords(const QString &command, QString &tableName,
+                       QString &fromTable, QStringList &fields,
+                       QStringList &fromFields) const;
 
     virtual QString recordsPhrase(TableModel *table);
-
-    virtual QString insertBulk(const QString &tableName, const PhraseList &ph, const QList<QVariantList> &vars);
-    virtual QString insertRecord(Table *t, QString tableName);
-    virtual QString updateRecord(Table *t, QString tableName);
+    virtual QString selectByKeys(const QString &tableName, const QString &key,
+                                 const QStringList &fields,
+                                 const QVariantList &keys);
+
+    virtual QString blobLength(const QString &tableName, const QString &field,
+                               const QString &key);
+    virtual QString blobRead(const QString &tableName, const QString &field,
+                             const QString &key);
+    virtual QString blobAppend(const QString &tableName, const QString &field,
+                               const QString &key);
+    virtual QString blobClear(const QString &tableName, const QString &field,
+                              const QString &key);
+
+    virtual QString insertBulk(const QString &tableName, const PhraseList &ph,
+                               const QList<QVariantList> &vars,
+                               const QStringList &returning = QStringList(),
+                               QVariantMap *binds = nullptr);
+    virtual QString insertRecords(const QString &tableName,
+                                  const QStringList &fields,
+                                  const QList<QVariantList> &vars,
+                                  const QStringList &returning = QStringList(),
+                                  QVariantMap *binds = nullptr);
+    virtual QString insertRecord(Table *t, QString tableName,
+                                 QVariantMap *binds = nullptr);
+    virtual QString updateRecords(const QString &tableName,
+                                  const QString &key,
+                                  const QStringList &fields,
+                                  const QList<QVariantList> &vars,
+                                  const QStringList &returning = QStringList(),
+                                  QVariantMap *binds = nullptr);
+    virtual QString updateRecord(Table *t, QString tableName,
+                                 QVariantMap *binds = nullptr);
     virtual QString deleteRecord(Table *t, QString tableName);
     virtual QString deleteRecords(const QString &tableName, const QString &where);
 
@@ -117,7 +187,9 @@ public:
                                   const PhraseList &order,
                                   const QList<RelationModel *> &joins,
                                   const int skip = -1,
-                                  const int take = -1);
+                                  const int take = -1,
+                                  const PhraseList &groupBy = PhraseList(),
+                                  const ConditionalPhrase &having = ConditionalPhrase());
 
     virtual QString selectCommand(const QString &tableName,
                                   const AgregateType &t,
@@ -150,14 +222,22 @@ public:
     virtual QString operatorString(const PhraseData::Condition &cond) const;
     virtual void appendSkipTake(QString &sql, int skip = -1, int take = -1);
     virtual QString primaryKeyConstraint(const TableModel *table) const;
+    virtual QString returningPhrase(const QStringList &fields) const;
+    virtual QString outputPhrase(const QStringList &fields) const;
+    virtual QString returningCommand(const QString &command,
+                                     TableModel *table,
+                                     const QStringList &fields);
+    QStringList returningFields(const TableModel *table);
 
 protected:
     virtual QString createConditionalPhrase(const PhraseData *d) const;
     QString createFieldPhrase(const PhraseList &ph);
     QString createOrderPhrase(const PhraseList &ph);
     void createInsertPhrase(const AssignmentPhraseList &ph, QString &fields, QString &values);
+    virtual QString castPhrase(const QString &value, FieldModel *field);
 
     QString agregateText(const AgregateType &t, const QString &arg = QString()) const;
+    QString agregateText(const PhraseData *d) const;
     QString fromTableText(const QString &tableName, QString &joinClassName, QString &orderBy) const;
 //    QString createWhere(QList<WherePhrase> &wheres);
 
@@ -18,17 +18,49 @@
 **
 **************************************************************************/
 
+#include <QtSql/QSqlQuery>
+
 #include "sqlitegenerator.h"
+#include "../database.h"
 #include "../table.h"
 #include "../tablemodel.h"
 
 NUT_BEGIN_NAMESPACE
 
-SqliteGenerator::SqliteGenerator(Database *parent) : SqlGeneratorBase(parent)
+SqliteGenerator::SqliteGenerator(Database *parent) : SqlGeneratorBase(parent),
+    _version(-1)
 {
 
 }
 
+/*!
+ * \brief SqliteGenerator::sqliteVersion
+ * \return Version of the sqlite library behind the connection, encoded as
+ * major * 1000000 + minor * 1000 + patch (like SQLITE_VERSION_NUMBER), or
+ * zero when it can not be detected
+ */
+int SqliteGenerator::sqliteVersion()
+{
+    if (_version != -1)
+        return _version;
+
+    Database *db = qobject_cast<Database*>(parent());
+    if (!db || !db->database().isOpen())
+        return 0;
+
+    _version = 0;
+    QSqlQuery q = db->database().exec("SELECT sqlite_version()");
+    if (q.next()) {
+        QStringList parts = q.value(0).toString().split('.');
+        while (parts.count() < 3)
+            parts.append("0");
+        _version = parts.at(0).toInt() * 1000000
+                + parts.at(1).toInt() * 1000
+                + parts.at(2).toInt();
+    }
+    return _version;
+}
+
 QString SqliteGenerator::fieldType(FieldModel *field)
 {
     switch (field->type) {
@@ -112,14 +144,33 @@ bool SqliteGenerator::supportAutoIncrement(const QMetaType::Type &type)
     return isNumeric(type);
 }
 
+bool SqliteGenerator::supportReturning()
+{
+    // RETURNING clause is available since sqlite 3.35.0
+    return sqliteVersion() >= 3035000;
+}
+
+/*
+ * Bound byte arrays are stored with BLOB storage class, values those
+ * stored as encoded text by older versions are still TEXT, so they are
+ * told apart when reading
+ */
+bool SqliteGenerator::supportBinaryParameters()
+{
+    return true;
+}
+
 
 QStringList SqliteGenerator::diff(TableModel *oldTable, TableModel *newTable)
 {
     QStringList ret;
 
-    if (oldTable && newTable)
-        if (*oldTable == *newTable)
+    if (oldTable && newTable) {
+        if (!isConstraintsChanged(oldTable, newTable)
+                && alterTable(oldTable, newTable, ret))
             return ret;
+        ret.clear();
+    }
 
     QStringList newTableSql = SqlGeneratorBase::diff(nullptr, newTable);
 
@@ -146,45 +197,168 @@ QStringList SqliteGenerator::diff(TableModel *oldTable, TableModel *newTable)
         if (!relations.contains(r->localColumn))
             relations.append(r->localColumn);
 
-    QString columns;
-    foreach (FieldModel *f, oldTable->fields()) {
-        if (!newTable->field(f->name))
+    QStringList columns;
+    QStringList oldColumns;
+    foreach (FieldModel *f, newTable->fields()) {
+        FieldModel *oldField = oldTable->field(f->name);
+        if (!oldField && !f->renamedFrom.isEmpty())
+            oldField = oldTable->field(f->renamedFrom);
+        if (!oldField)
             continue;
 
-        if (!columns.isEmpty())
-            columns.append(", ");
         columns.append(f->name);
+        oldColumns.append(oldField->name);
     }
 
     /*
-    ALTER TABLE sampleTable RENAME TO sqlitestudio_temp_table;
-
-    CREATE TABLE sampleTable (
-        id INTEGER PRIMARY KEY AUTOINCREMENT,
-        t  BIGINT,
-        m  CHAR
-    );
-
-    INSERT INTO sampleTable (
-                                id,
-                                t,
-                                m
-                            )
-                            SELECT id,
-                                   t,
-                                   m
-                              FROM sqlitestudio_temp_table;
-
-    DROP TABLE sqlitestudio_temp_table;
+     * Order documented by sqlite for changing schema of a table. Renaming
+     * the old table would rewrite references of child tables to it since
+     * 3.26.0, so new table is created aside and renamed at the end:
+
+    PRAGMA foreign_keys=OFF;
+    CREATE TABLE nut_rebuild_sampleTable (...);
+    INSERT INTO nut_rebuild_sampleTable ( id, t, m )
+        SELECT id, t, m FROM sampleTable;
+    DROP TABLE sampleTable;
+    ALTER TABLE nut_rebuild_sampleTable RENAME TO sampleTable;
+    PRAGMA foreign_key_check;
     */
 
-    ret.append("ALTER TABLE " + newTable->name() + " RENAME TO sqlitestudio_temp_table;");
-    ret.append(newTableSql);
-    ret.append(QString("INSERT INTO %1 ( %2 ) SELECT %2 FROM sqlitestudio_temp_table;")
-               .arg(newTable->name(), columns));
-    ret.append("DROP TABLE sqlitestudio_temp_table;");
+    QString tempName = __NUT_REBUILD_TABLE_PREFIX + newTable->name();
+    QString create = newTableSql.takeFirst();
+    create.replace(0, QString("CREATE TABLE " + newTable->name()).length(),
+                   "CREATE TABLE " + tempName);
+
+    ret.append("PRAGMA foreign_keys=OFF");
+    ret.append(create);
+    if (columns.count())
+        ret.append(copyRecords(tempName, oldTable->name(),
+                               columns, oldColumns));
+    ret.append("DROP TABLE " + oldTable->name());
+    ret.append("ALTER TABLE " + tempName + " RENAME TO " + newTable->name());
+    ret.append("PRAGMA foreign_key_check(" + newTable->name() + ")");
     return ret;
 }
+
+void SqliteGenerator::diffIndexes(TableModel *oldTable, TableModel *newTable,
+                                  QStringList &drops, QStringList &creates)
+{
+    // Indexes of a rebuilt table are dropped with the old table, so all
+    // of them are created again
+    if (oldTable && newTable && isRebuildNeeded(oldTable, newTable)) {
+        SqlGeneratorBase::diffIndexes(nullptr, newTable, drops, creates);
+        return;
+    }
+    SqlGeneratorBase::diffIndexes(oldTable, newTable, drops, creates);
+}
+
+/*
+ * Sqlite can not add or drop constraints of an existing table, they are
+ * declared inside of create table and changing them rebuilds the table
+ */
+QStringList SqliteGenerator::constraints(TableModel *table)
+{
+    QStringList ret;
+    foreach (RelationModel *r, table->foreignKeys())
+        if (r->isConstraint && r->masterTable)
+            ret.append(relationDeclare(r));
+    return ret;
+}
+
+void SqliteGenerator::diffRelation(TableModel *oldTable, TableModel *newTable,
+                                   QStringList &drops, QStringList &creates)
+{
+    Q_UNUSED(oldTable)
+    Q_UNUSED(newTable)
+    Q_UNUSED(drops)
+    Q_UNUSED(creates)
+}
+
+/*
+ * Applies changes of columns with alter table when possible, returns
+ * false when table must be rebuilt. ADD COLUMN is available in all
+ * versions, RENAME COLUMN since 3.25.0 and DROP COLUMN since 3.35.0
+ */
+bool SqliteGenerator::alterTable(TableModel *oldTable, TableModel *newTable,
+                                 QStringList &sql)
+{
+    int version = sqliteVersion();
+    QSet<QString> keptColumns;
+
+    foreach (FieldModel *f, newTable->fields()) {
+        FieldModel *oldField = oldTable->field(f->name);
+        if (oldField) {
+            keptColumns.insert(oldField->name);
+            if (*oldField != *f)
+                return false;
+            continue;
+        }
+
+        if (!f->renamedFrom.isEmpty())
+            oldField = oldTable->field(f->renamedFrom);
+
+        if (oldField && !newTable->field(oldField->name)) {
+            FieldModel renamed = *oldField;
+            renamed.name = f->name;
+            if (version < 3025000 || renamed != *f)
+                return false;
+
+            keptColumns.insert(oldField->name);
+            sql.append(QString("ALTER TABLE %1 RENAME COLUMN %2 TO %3")
+                       .arg(newTable->name(), oldField->name, f->name));
+            continue;
+        }
+
+        // Existing rows can not fill these columns
+        if (f->isPrimaryKey || f->isUnique || f->notNull)
+            return false;
+
+        sql.append(QString("ALTER TABLE %1 ADD COLUMN %2")
+                   .arg(newTable->name(), fieldDeclare(f)));
+    }
+
+    foreach (FieldModel *f, oldTable->fields()) {
+        if (keptColumns.contains(f->name))
+            continue;
+
+        if (version < 3035000 || f->isPrimaryKey)
+            return false;
+
+        sql.append(QString("ALTER TABLE %1 DROP COLUMN %2")
+                   .arg(oldTable->name(), f->name));
+    }
+
+    return true;
+}
+
+bool SqliteGenerator::isRebuildNeeded(TableModel *oldTable,
+                                      TableModel *newTable)
+{
+    if (isConstraintsChanged(oldTable, newTable))
+        return true;
+
+    QStringList sql;
+    return !alterTable(oldTable, newTable, sql);
+}
+
+bool SqliteGenerator::isConstraintsChanged(TableModel *oldTable,
+                                           TableModel *newTable) const
+{
+    foreach (RelationModel *r, newTable->foreignKeys()) {
+        RelationModel *oldRel = oldTable->foreignKeyByField(r->localColumn);
+        bool wasConstraint = oldRel && oldRel->isConstraint;
+        if (r->isConstraint != wasConstraint
+                || (r->isConstraint && r->onDelete != oldRel->onDelete))
+            return true;
+    }
+
+    foreach (RelationModel *r, oldTable->foreignKeys())
+        if (r->isConstraint && !newTable->foreignKeyByField(r->localColumn))
+            return true;
+
+    return false;
+}
+
 void SqliteGenerator::appendSkipTake(QString &sql, int skip, int take)
 {
     if (take > 0 && skip > 0) {
@@ -324,4 +498,63 @@ QVariant SqliteGenerator::unescapeValue(const QMetaType::Type &type, const QVari
     return SqlGeneratorBase::unescapeValue(type, dbValue);
 }
 
+QString SqliteGenerator::blobRead(const QString &tableName,
+                                  const QString &field, const QString &key)
+{
+    return QString("SELECT substr(%2, :offset, :length) FROM %1 WHERE %3 = :key")
+            .arg(tableName, field, key);
+}
+
+/*
+ * || returns text, so result is casted back to keep BLOB storage class
+ */
+QString SqliteGenerator::blobAppend(const QString &tableName,
+                                    const QString &field, const QString &key)
+{
+    return QString("UPDATE %1 SET %2 = CAST(COALESCE(%2, X'') || :chunk AS BLOB) "
+                   "WHERE %3 = :key")
+            .arg(tableName, field, key);
+}
+
+/*
+ * Commands of incremental blob I/O, rowid of row is opened and reserved
+ * size is filled by zero bytes that are written in place. Written data
+ * shorter than reserved size is truncated to :length
+ */
+QString SqliteGenerator::blobRowId(const QString &tableName,
+                                   const QString &key)
+{
+    return QString("SELECT rowid FROM %1 WHERE %2 = :key")
+            .arg(tableName, key);
+}
+
+QString SqliteGenerator::blobReserve(const QString &tableName,
+                                     const QString &field,
+                                     const QString &key)
+{
+    return QString("UPDATE %1 SET %2 = zeroblob(:size) WHERE %3 = :key")
+            .arg(tableName, field, key);
+}
+
+QString SqliteGenerator::blobTruncate(const QString &tableName,
+                                      const QString &field,
+                                      const QString &key)
+{
+    return QString("UPDATE %1 SET %2 = substr(%2, 1, :length) WHERE %3 = :key")
+            .arg(tableName, field, key);
+}
+
+bool SqliteGenerator::unescapeNativeValue(const QMetaType::Type &type,
+                                          const QVariant &dbValue,
+                                          QVariant &value) const
+{
+    if (type == QMetaType::QByteArray
+            && dbValue.userType() == QMetaType::QByteArray) {
+        value = dbValue;
+        return true;
+    }
+
+    return SqlGeneratorBase::unescapeNativeValue(type, dbValue, value);
+}
+
 NUT_END_NAMESPACE
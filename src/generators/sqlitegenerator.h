@@ -28,23 +28,52 @@ NUT_BEGIN_NAMESPACE
 
 class SqliteGenerator : public SqlGeneratorBase
 {
+    int _version;
+
 public:
     explicit SqliteGenerator(Database *parent = nullptr);
 
+    int sqliteVersion();
+
     QString fieldType(FieldModel *field) override;
     QString fieldDeclare(FieldModel *field) override;
 
     bool supportAutoIncrement(const QMetaType::Type &type) override;
+    bool supportReturning() override;
+    bool supportBinaryParameters() override;
 
     void appendSkipTake(QString &sql, int skip, int take) override;
 
     QString primaryKeyConstraint(const TableModel *table) const override;
+    QStringList constraints(TableModel *table) override;
     QStringList diff(TableModel *oldTable, TableModel *newTable) override;
+    void diffIndexes(TableModel *oldTable, TableModel *newTable,
+                     QStringList &drops, QStringList &creates) override;
+    void diffRelation(TableModel *oldTable, TableModel *newTable,
+                      QStringList &drops, QStringList &creates) override;
 
     QString createConditionalPhrase(const PhraseData *d) const override;
 
+    QString blobRead(const QString &tableName, const QString &field,
+                     const QString &key) override;
+    QString blobAppend(const QString &tableName, const QString &field,
+                       const QString &key) override;
+    QString blobRowId(const QString &tableName, const QString &key);
+    QString blobReserve(const QString &tableName, const QString &field,
+                        const QString &key);
+    QString blobTruncate(const QString &tableName, const QString &field,
+                         const QString &key);
+
     QString escapeValue(const QVariant &v) const override;
     QVariant unescapeValue(const QMetaType::Type &type, const QVariant &dbValue) override;
+    bool unescapeNativeValue(const QMetaType::Type &type,
+                             const QVariant &dbValue,
+                             QVariant &value) const override;
+
+private:
+    bool alterTable(TableModel *oldTable, TableModel *newTable, QStringList &sql);
+    bool isRebuildNeeded(TableModel *oldTable, TableModel *newTable);
+    bool isConstraintsChanged(TableModel *oldTable, TableModel *newTable) const;
 };
 
 NUT_END_NAMESPACE
@@ -234,6 +234,59 @@ void SqlServerGenerator::appendSkipTake(QString &sql, int skip, int take)
                    .arg(skip > 1 ? "NEXT" : "FIRST"));
 }
 
+bool SqlServerGenerator::supportReturning()
+{
+    return true;
+}
+
+QString SqlServerGenerator::returningPhrase(const QStringList &fields) const
+{
+    Q_UNUSED(fields);
+    return QString();
+}
+
+/*
+ * OUTPUT without INTO is rejected on tables that have triggers, so stored
+ * rows are written to a table variable and selected from it
+ */
+QString SqlServerGenerator::outputPhrase(const QStringList &fields) const
+{
+    if (!fields.count())
+        return QString();
+
+    QStringList inserted;
+    foreach (QString f, fields)
+        inserted.append("INSERTED." + f);
+    return "OUTPUT " + inserted.join(", ") + " INTO @nut_output";
+}
+
+QString SqlServerGenerator::returningCommand(const QString &command,
+                                             TableModel *table,
+                                             const QStringList &fields)
+{
+    QStringList columns;
+    foreach (QString f, fields) {
+        FieldModel *field = table ? table->field(f) : nullptr;
+        QString type = field ? fieldType(field) : QString();
+        type.remove(" IDENTITY(1,1)");
+        if (type == "TEXT")
+            type = "NVARCHAR(MAX)";
+        else if (type.isEmpty())
+            type = "SQL_VARIANT";
+        columns.append(f + " " + type);
+    }
+
+    return QString("SET NOCOUNT ON; DECLARE @nut_output TABLE (%1); %2; "
+                   "SELECT %3 FROM @nut_output")
+            .arg(columns.join(", "), command, fields.join(", "));
+}
+
+QString SqlServerGenerator::dropIndex(const TableModel *table,
+                                      const IndexModel *index)
+{
+    return QString("DROP INDEX %1 ON %2").arg(index->name, table->name());
+}
+
 QString SqlServerGenerator::createConditionalPhrase(const PhraseData *d) const
 {
     if (!d)
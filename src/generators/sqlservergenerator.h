@@ -41,6 +41,14 @@ public:
 
     void appendSkipTake(QString &sql, int skip, int take) override;
 
+    bool supportReturning() override;
+    QString returningPhrase(const QStringList &fields) const override;
+    QString outputPhrase(const QStringList &fields) const override;
+    QString returningCommand(const QString &command, TableModel *table,
+                             const QStringList &fields) override;
+
+    QString dropIndex(const TableModel *table, const IndexModel *index) override;
+
 protected:
     QString createConditionalPhrase(const PhraseData *d) const override;
 };
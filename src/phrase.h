@@ -31,6 +31,8 @@
 #include "phrases/assignmentphrase.h"
 #include "phrases/numericphrase.h"
 #include "phrases/datephrase.h"
+#include "phrases/parameter.h"
+#include "phrases/aggregatephrase.h"
 
 NUT_BEGIN_NAMESPACE
 
@@ -33,24 +33,18 @@ AbstractFieldPhrase::AbstractFieldPhrase(const char *className,
 
 AbstractFieldPhrase::AbstractFieldPhrase(const AbstractFieldPhrase &other)
 {
-    data = other.data;
-    data->parents++;
+    data = PhraseData::ref(other.data);
 }
 
 AbstractFieldPhrase::AbstractFieldPhrase(AbstractFieldPhrase &&other)
 {
     data = other.data;
-    data->parents++;
     other.data = nullptr;
 }
 
 AbstractFieldPhrase::~AbstractFieldPhrase()
 {
-    if (data) {
-        --data->parents;
-        if (data->parents <= 0)
-            delete data;
-    }
+    PhraseData::deref(data);
 }
 
 PhraseList AbstractFieldPhrase::operator |(const AbstractFieldPhrase &other)
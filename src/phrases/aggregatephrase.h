@@ -0,0 +1,98 @@
+/**************************************************************************
+**
+** This file is part of Nut project.
+** https://github.com/HamedMasafi/Nut
+**
+** Nut is free software: you can redistribute it and/or modify
+** it under the terms of the GNU Lesser General Public License as published by
+** the Free Software Foundation, either version 3 of the License, or
+** (at your option) any later version.
+**
+** Nut is distributed in the hope that it will be useful,
+** but WITHOUT ANY WARRANTY; without even the implied warranty of
+** MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+** GNU Lesser General Public License for more details.
+**
+** You should have received a copy of the GNU Lesser General Public License
+** along with Nut.  If not, see <http://www.gnu.org/licenses/>.
+**
+**************************************************************************/
+
+#ifndef AGGREGATEPHRASE_H
+#define AGGREGATEPHRASE_H
+
+#include "../defines.h"
+#include "conditionalphrase.h"
+#include "fieldphrase.h"
+
+NUT_BEGIN_NAMESPACE
+
+/*
+ * Aggregate function over a field (or all rows for count), T is type of
+ * its value. Can be selected or compared in having phrase:
+ * Nut::count() > 2
+ */
+template<typename T>
+class AggregatePhrase : public ConditionalPhrase
+{
+public:
+    AggregatePhrase(PhraseData::Condition cond, const AbstractFieldPhrase *field)
+    {
+        data = new PhraseData(field ? field->data : nullptr, cond);
+    }
+};
+
+inline AggregatePhrase<int> count()
+{
+    return AggregatePhrase<int>(PhraseData::AgregateCount, nullptr);
+}
+
+template<typename T, typename E>
+inline AggregatePhrase<int> count(const FieldPhrase<T, E> &f)
+{
+    return AggregatePhrase<int>(PhraseData::AgregateCount, &f);
+}
+
+template<typename T, typename E>
+inline AggregatePhrase<T> sum(const FieldPhrase<T, E> &f)
+{
+    return AggregatePhrase<T>(PhraseData::AgregateSum, &f);
+}
+
+template<typename T, typename E>
+inline AggregatePhrase<T> min(const FieldPhrase<T, E> &f)
+{
+    return AggregatePhrase<T>(PhraseData::AgregateMin, &f);
+}
+
+template<typename T, typename E>
+inline AggregatePhrase<T> max(const FieldPhrase<T, E> &f)
+{
+    return AggregatePhrase<T>(PhraseData::AgregateMax, &f);
+}
+
+template<typename T, typename E>
+inline AggregatePhrase<double> average(const FieldPhrase<T, E> &f)
+{
+    return AggregatePhrase<double>(PhraseData::AgregateAverage, &f);
+}
+
+// Type of value read for a selected phrase
+template<typename T>
+struct PhraseValueType;
+
+template<typename T, typename E>
+struct PhraseValueType<FieldPhrase<T, E> >
+{
+    typedef T type;
+};
+
+template<typename T>
+struct PhraseValueType<AggregatePhrase<T> >
+{
+    typedef T type;
+};
+
+NUT_END_NAMESPACE
+
+#endif // AGGREGATEPHRASE_H
@@ -24,10 +24,13 @@
 
 NUT_BEGIN_NAMESPACE
 
+// Takes the reference of given node
 AssignmentPhrase::AssignmentPhrase(PhraseData *d) : data(d)
-{
-    d->parents++;
-}
+{ }
+
+AssignmentPhrase::AssignmentPhrase(const AssignmentPhrase &other)
+    : data(PhraseData::ref(other.data))
+{ }
 
 AssignmentPhrase::AssignmentPhrase(AbstractFieldPhrase *l, const QVariant r)
 {
@@ -56,9 +59,7 @@ AssignmentPhrase::AssignmentPhrase(AssignmentPhrase *ph, const QVariant &v)
 
 AssignmentPhrase::~AssignmentPhrase()
 {
-    if (data)
-        if (!--data->parents)
-            delete data;
+    PhraseData::deref(data);
 }
 
 NUT_END_NAMESPACE
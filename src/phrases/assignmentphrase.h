@@ -38,6 +38,7 @@ public:
     explicit AssignmentPhrase(AbstractFieldPhrase *l, const AssignmentPhrase *r);
     explicit AssignmentPhrase(AssignmentPhrase *ph, const QVariant &v);
 //    explicit AssignmentPhrase(AssignmentPhrase &other);
+    AssignmentPhrase(const AssignmentPhrase &other);
     ~AssignmentPhrase();
 //    AssignmentPhrase(AssignmentPhrase *l, const AssignmentPhrase *r);
 
@@ -66,11 +66,16 @@ AssignmentPhraseList AssignmentPhraseList::operator &(const AssignmentPhrase
     return AssignmentPhraseList(this, &ph);
 }
 
+AssignmentPhraseList::AssignmentPhraseList(const AssignmentPhraseList &other)
+    : data(other.data)
+{
+    incAllDataParents();
+}
+
 AssignmentPhraseList::~AssignmentPhraseList()
 {
     foreach (PhraseData *d, data)
-        if (!--d->parents)
-            delete d;
+        PhraseData::deref(d);
 //    qDeleteAll(data);
     //    data.clear();
 }
@@ -78,7 +83,7 @@ AssignmentPhraseList::~AssignmentPhraseList()
 void AssignmentPhraseList::incAllDataParents()
 {
     foreach (PhraseData *d, data)
-        d->parents++;
+        d->parents.ref();
 }
 
 
@@ -36,6 +36,7 @@ public:
     AssignmentPhraseList(AssignmentPhraseList *l, const AssignmentPhrase *r);
     AssignmentPhraseList(AssignmentPhrase *l, const AssignmentPhrase *r);
     AssignmentPhraseList(const AssignmentPhrase &r, const AssignmentPhrase &l);
+    AssignmentPhraseList(const AssignmentPhraseList &other);
 
     AssignmentPhraseList operator &(const AssignmentPhrase &ph);
 
@@ -29,22 +29,20 @@ ConditionalPhrase::ConditionalPhrase() : data(nullptr)
 
 ConditionalPhrase::ConditionalPhrase(const ConditionalPhrase &other)
 {
-    data = other.data;
-    data->parents++;
-//    const_cast<ConditionalPhrase&>(other).data = 0;
+    data = PhraseData::ref(other.data);
 }
 
 #ifdef Q_COMPILER_RVALUE_REFS
-ConditionalPhrase::ConditionalPhrase(const ConditionalPhrase &&other)
+ConditionalPhrase::ConditionalPhrase(ConditionalPhrase &&other)
 {
-    this->data = qMove(other.data);
+    data = other.data;
+    other.data = nullptr;
 }
 #endif
 
 ConditionalPhrase::ConditionalPhrase(const PhraseData *data)
 {
-    this->data = const_cast<PhraseData*>(data);
-    this->data->parents++;
+    this->data = PhraseData::ref(const_cast<PhraseData*>(data));
 }
 
 ConditionalPhrase::ConditionalPhrase(AbstractFieldPhrase *l,
@@ -72,7 +70,6 @@ ConditionalPhrase::ConditionalPhrase(AbstractFieldPhrase *l,
                                      ConditionalPhrase &r)
 {
     data = new PhraseData(l->data, cond, r.data);
-    r.data = nullptr;
 }
 
 ConditionalPhrase::ConditionalPhrase(ConditionalPhrase *l,
@@ -80,7 +77,6 @@ ConditionalPhrase::ConditionalPhrase(ConditionalPhrase *l,
                                      const AbstractFieldPhrase &r)
 {
     data = new PhraseData(l->data, cond, r.data);
-    l->data = nullptr;
 }
 
 ConditionalPhrase::ConditionalPhrase(ConditionalPhrase *l,
@@ -88,7 +84,6 @@ ConditionalPhrase::ConditionalPhrase(ConditionalPhrase *l,
                                      const QVariant &r)
 {
     data = new PhraseData(l->data, cond, r);
-    l->data = nullptr;
 }
 
 ConditionalPhrase::ConditionalPhrase(ConditionalPhrase *l,
@@ -96,24 +91,18 @@ ConditionalPhrase::ConditionalPhrase(ConditionalPhrase *l,
                                      ConditionalPhrase &r)
 {
     data = new PhraseData(l->data, cond, r.data);
-    l->data = nullptr;
-    r.data = nullptr;
 }
 
 ConditionalPhrase::~ConditionalPhrase()
 {
-    if (data) {
-        data->cleanUp();
-        if (!--data->parents)
-            delete data;
-    }
+    PhraseData::deref(data);
 }
 
 ConditionalPhrase &ConditionalPhrase::operator =(const ConditionalPhrase &other)
 {
-    data = other.data;
-    if (data)
-        data->parents++;
+    PhraseData *old = data;
+    data = PhraseData::ref(other.data);
+    PhraseData::deref(old);
     return *this;
 }
 
@@ -144,51 +133,27 @@ ConditionalPhrase operator op(const ConditionalPhrase &l, \
                               const ConditionalPhrase &r) \
 { \
     ConditionalPhrase p; \
-    p.data = new PhraseData; \
-    p.data->type = PhraseData::WithOther; \
-    p.data->operatorCond = cond; \
-    p.data->left = l.data; \
-    p.data->right = r.data; \
-    l.data->parents++;  \
-    r.data->parents++;  \
+    p.data = new PhraseData(l.data, cond, r.data); \
     return p; \
 } \
 ConditionalPhrase operator op(const ConditionalPhrase &l, \
                               ConditionalPhrase &&r) \
 { \
     ConditionalPhrase p; \
-    p.data = new PhraseData; \
-    p.data->type = PhraseData::WithOther; \
-    p.data->operatorCond = cond; \
-    p.data->left = l.data; \
-    p.data->right = r.data; \
-    l.data->parents++;  \
-    r.data->parents++;  \
+    p.data = new PhraseData(l.data, cond, r.data); \
     return p; \
 } \
 ConditionalPhrase operator op(ConditionalPhrase &&l, \
                               const ConditionalPhrase &r) \
 { \
     ConditionalPhrase p; \
-    p.data = new PhraseData; \
-    p.data->type = PhraseData::WithOther; \
-    p.data->operatorCond = cond; \
-    p.data->left = l.data; \
-    p.data->right = r.data; \
-    l.data->parents++;  \
-    r.data->parents++;  \
+    p.data = new PhraseData(l.data, cond, r.data); \
     return p; \
 } \
 ConditionalPhrase operator op(ConditionalPhrase &&l, ConditionalPhrase &&r) \
 { \
     ConditionalPhrase p; \
-    p.data = new PhraseData; \
-    p.data->type = PhraseData::WithOther; \
-    p.data->operatorCond = cond; \
-    p.data->left = l.data; \
-    p.data->right = r.data; \
-    l.data->parents++;  \
-    r.data->parents++;  \
+    p.data = new PhraseData(l.data, cond, r.data); \
     return p; \
 }
 
@@ -198,7 +163,9 @@ DECLARE_CONDITIONALPHRASE_OPERATORS_IMPL(&&, PhraseData::And)
 
 ConditionalPhrase ConditionalPhrase::operator !()
 {
-    ConditionalPhrase f(data);
+    // nodes may be shared with other phrases, so negate a copy
+    ConditionalPhrase f;
+    f.data = new PhraseData(data);
     f.data->isNot = !data->isNot;
     return f;
 }
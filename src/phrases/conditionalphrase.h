@@ -42,7 +42,7 @@ public:
     ConditionalPhrase();
     ConditionalPhrase(const ConditionalPhrase &other);
 #ifdef Q_COMPILER_RVALUE_REFS
-    ConditionalPhrase(const ConditionalPhrase &&other);
+    ConditionalPhrase(ConditionalPhrase &&other);
 #endif
     explicit ConditionalPhrase(const PhraseData *data);
     ConditionalPhrase(AbstractFieldPhrase *, PhraseData::Condition);
@@ -0,0 +1,64 @@
+/**************************************************************************
+**
+** This file is part of Nut project.
+** https://github.com/HamedMasafi/Nut
+**
+** Nut is free software: you can redistribute it and/or modify
+** it under the terms of the GNU Lesser General Public License as published by
+** the Free Software Foundation, either version 3 of the License, or
+** (at your option) any later version.
+**
+** Nut is distributed in the hope that it will be useful,
+** but WITHOUT ANY WARRANTY; without even the implied warranty of
+** MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+** GNU Lesser General Public License for more details.
+**
+** You should have received a copy of the GNU Lesser General Public License
+** along with Nut.  If not, see <http://www.gnu.org/licenses/>.
+**
+**************************************************************************/
+
+#ifndef PARAMETER_H
+#define PARAMETER_H
+
+#include <QtCore/QMetaType>
+#include <QtCore/QString>
+#include <QtCore/QVariant>
+
+#include "../defines.h"
+
+NUT_BEGIN_NAMESPACE
+
+/*
+ * Placeholder of a value that is bound when a compiled query is executed,
+ * generators write it as :name
+ */
+struct Parameter
+{
+    QString name;
+    int type;
+};
+
+NUT_END_NAMESPACE
+
+Q_DECLARE_METATYPE(NUT_WRAP_NAMESPACE(Parameter))
+
+NUT_BEGIN_NAMESPACE
+
+template<typename T>
+inline QVariant param(const QString &name)
+{
+    Parameter p;
+    p.name = name;
+    p.type = qMetaTypeId<T>();
+    return QVariant::fromValue(p);
+}
+
+inline bool isParameter(const QVariant &v)
+{
+    return v.userType() == qMetaTypeId<Parameter>();
+}
+
+NUT_END_NAMESPACE
+
+#endif // PARAMETER_H
@@ -19,9 +19,16 @@
 **************************************************************************/
 
 #include "phrasedata.h"
+#include "../rowpool_p.h"
 
 NUT_BEGIN_NAMESPACE
 
+/*
+ * Nodes are immutable after the phrase that creates them is built, a node
+ * keeps a reference to its children and a tree is shared between phrases
+ * by reference counting, so it can be reused or read from other threads.
+ */
+
 PhraseData::PhraseData() :
     className(""), fieldName(""),
     type(Field), operatorCond(NotAssign),
@@ -36,38 +43,46 @@ PhraseData::PhraseData(const char *className, const char *fieldName) :
 
 PhraseData::PhraseData(PhraseData *l, PhraseData::Condition o)
     : className(nullptr), fieldName(nullptr),
-      type(WithoutOperand), operatorCond(o), left(l), right(nullptr),
+      type(WithoutOperand), operatorCond(o), left(ref(l)), right(nullptr),
       isNot(false), parents(1)
-{
-    l->parents++;
-}
+{ }
 
 PhraseData::PhraseData(PhraseData *l, PhraseData::Condition o,
                        PhraseData *r)
     : className(nullptr), fieldName(nullptr),
       type(WithOther), operatorCond(o),
-      left(l), right(r),
+      left(ref(l)), right(ref(r)),
       isNot(false), parents(1)
-{
-    l->parents++;
-    r->parents++;
-}
+{ }
 
 PhraseData::PhraseData(PhraseData *l, PhraseData::Condition o, QVariant r)
     : className(nullptr), fieldName(nullptr),
-      type(WithVariant), operatorCond(o), left(l),
+      type(WithVariant), operatorCond(o), left(ref(l)),
       right(nullptr), operand(r), isNot(false), parents(1)
 { }
 
+PhraseData::PhraseData(const PhraseData *other)
+    : className(other->className), fieldName(other->fieldName),
+      type(other->type), operatorCond(other->operatorCond),
+      left(ref(other->left)), right(ref(other->right)),
+      operand(other->operand), isNot(other->isNot), parents(1)
+{ }
+
+PhraseData::~PhraseData()
+{
+    deref(left);
+    deref(right);
+}
+
 PhraseData *PhraseData::operator =(PhraseData *other)
 {
-    other->parents++;
+    other->parents.ref();
     return other;
 }
 
 PhraseData &PhraseData::operator =(PhraseData &other)
 {
-    other.parents++;
+    other.parents.ref();
     return other;
 }
 
@@ -76,16 +91,27 @@ QString PhraseData::toString() const
     return QString("[%1].%2").arg(className, fieldName);
 }
 
-void PhraseData::cleanUp()
+void *PhraseData::operator new(std::size_t size)
+{
+    return RowPool::allocate(size);
+}
+
+void PhraseData::operator delete(void *p, std::size_t size)
+{
+    RowPool::release(p, size);
+}
+
+PhraseData *PhraseData::ref(PhraseData *d)
 {
+    if (d)
+        d->parents.ref();
+    return d;
 }
 
-void PhraseData::cleanUp(PhraseData *d)
+void PhraseData::deref(PhraseData *d)
 {
-    if (d->left)
-        cleanUp(d->left);
-    if (d->right)
-        cleanUp(d->right);
+    if (d && !d->parents.deref())
+        delete d;
 }
 
 NUT_END_NAMESPACE
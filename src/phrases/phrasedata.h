@@ -21,6 +21,9 @@
 #ifndef PHRASEDATA_H
 #define PHRASEDATA_H
 
+#include <QtCore/QAtomicInt>
+#include <cstddef>
+
 #include "../defines.h"
 
 NUT_BEGIN_NAMESPACE
@@ -78,7 +81,14 @@ public:
         DatePartHour,
         DatePartMinute,
         DatePartSecond,
-        DatePartMilisecond
+        DatePartMilisecond,
+
+        // aggregate functions
+        AgregateCount,
+        AgregateSum,
+        AgregateMin,
+        AgregateMax,
+        AgregateAverage
 //        // special types
 //        Distance
     };
@@ -97,7 +107,7 @@ public:
 
     QVariant operand;
     bool isNot;
-    quint16 parents;
+    QAtomicInt parents;
 
     PhraseData();
     PhraseData(const char *className, const char *fieldName);
@@ -105,18 +115,20 @@ public:
     PhraseData(PhraseData *l, Condition o, PhraseData *r);
     PhraseData(PhraseData *l, Condition o, QVariant r);
 //    explicit PhraseData(const PhraseData &other);
-//    explicit PhraseData(const PhraseData *other);
+    explicit PhraseData(const PhraseData *other);
 
     PhraseData *operator =(PhraseData *other);
     PhraseData &operator =(PhraseData &other);
 
     QString toString() const;
 
-    ~PhraseData() = default;
+    ~PhraseData();
+
+    static void *operator new(std::size_t size);
+    static void operator delete(void *p, std::size_t size);
 
-    void cleanUp();
-private:
-    void cleanUp(PhraseData *d);
+    static PhraseData *ref(PhraseData *d);
+    static void deref(PhraseData *d);
 };
 
 NUT_END_NAMESPACE
@@ -37,25 +37,22 @@ PhraseDataList::PhraseDataList(const PhraseDataList &other) : QList<PhraseData*>
 
 void PhraseDataList::append(PhraseData *d)
 {
-    d->parents++;
+    d->parents.ref();
     QList<PhraseData*>::append(d);
 }
 
 void PhraseDataList::append(QList<PhraseData *> &dl)
 {
     foreach (PhraseData *d, dl)
-        d->parents++;
+        d->parents.ref();
     QList<PhraseData*>::append(dl);
 }
 
 PhraseDataList::~PhraseDataList()
 {
     QList<PhraseData*>::iterator i;
-    for (i = begin(); i != end(); ++i) {
-        (*i)->cleanUp();
-        if (!--(*i)->parents)
-            delete *i;
-    }
+    for (i = begin(); i != end(); ++i)
+        PhraseData::deref(*i);
 }
 
 NUT_END_NAMESPACE
@@ -34,9 +34,10 @@ PhraseList::PhraseList(const PhraseList &other) : isValid(true)
     const_cast<PhraseList&>(other).data.clear();
 }
 
-PhraseList::PhraseList(PhraseList &&other)
+PhraseList::PhraseList(PhraseList &&other) : isValid(other.isValid)
 {
     data = other.data;
+    other.data.clear();
 }
 
 PhraseList::PhraseList(const AbstractFieldPhrase &other) : isValid(true)
@@ -23,7 +23,8 @@
 NUT_BEGIN_NAMESPACE
 
 QueryPrivate::QueryPrivate(QueryBase *parent) : q_ptr(parent),
-    database(nullptr), tableSet(nullptr), skip(-1), take(-1)
+    database(nullptr), tableSet(nullptr), skip(-1), take(-1),
+    noTracking(false)
 {
 
 }
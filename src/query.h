@@ -30,6 +30,7 @@
 #include <QtSql/QSqlError>
 #include <QtSql/QSqlQueryModel>
 #include <QtSql/QSqlQuery>
+#include <QtSql/QSqlRecord>
 
 #ifdef NUT_SHARED_POINTER
 #include <QtCore/QSharedPointer>
@@ -45,6 +46,8 @@
 #include "phrase.h"
 #include "tablemodel.h"
 #include "sqlmodel.h"
+#include "compiledquery.h"
+#include "tuple.h"
 
 NUT_BEGIN_NAMESPACE
 
@@ -79,6 +82,9 @@ public:
     Query<T> *orderBy(const PhraseList &ph);
     Query<T> *where(const ConditionalPhrase &ph);
     Query<T> *setWhere(const ConditionalPhrase &ph);
+    Query<T> *asNoTracking();
+    Query<T> *groupBy(const PhraseList &ph);
+    Query<T> *having(const ConditionalPhrase &ph);
 
     //data selecting
     Row<T> first();
@@ -89,6 +95,19 @@ public:
     template<typename O>
     QList<O> select(const std::function<O(const QSqlQuery &q)> allocator);
 
+    template<typename P1, typename P2, typename... Ps>
+    QList<std::tuple<typename PhraseValueType<P1>::type,
+                     typename PhraseValueType<P2>::type,
+                     typename PhraseValueType<Ps>::type...> >
+    select(const P1 &p1, const P2 &p2, const Ps &... phrases);
+
+    template<typename S, typename... Ps>
+    QList<S> selectAs(const Ps &... phrases);
+
+    template<typename... Ps>
+    QList<std::tuple<typename PhraseValueType<Ps>::type...> >
+    aggregate(const Ps &... phrases);
+
     int count();
     QVariant max(const FieldPhrase<int> &f);
     QVariant min(const FieldPhrase<int> &f);
@@ -106,8 +125,35 @@ public:
     void toModel(QSqlQueryModel *model);
     void toModel(SqlModel *model);
 
+    template<typename... Args>
+    CompiledQuery<T, Args...> compile();
+
     //debug purpose
     QString sqlCommand() const;
+
+private:
+    template<typename... Ts>
+    QList<std::tuple<Ts...> > selectTuples(const PhraseList &fields);
+
+    static const char *projectionKey(Database *database,
+                                     const PhraseList &fields);
+    static void bindModel(SqlModel *model, Database *database,
+                          TableSetBase *tableSet,
+                          const ConditionalPhrase &where,
+                          const PhraseDataList &orderData,
+                          const PhraseDataList &fieldsData);
+    static ConditionalPhrase keysetPhrase(const char *className,
+                                          const QList<const char*> &names,
+                                          const QList<bool> &descending,
+                                          const QVariantList &values);
+
+    static RowList<T> readRows(QSqlQuery &q, Database *database,
+                               const QString &tableName,
+                               const QList<RelationModel*> &relations,
+                               TableSetBase *tableSet, QObject *parent);
+
+    template<class, typename...>
+    friend class CompiledQuery;
 };
 
 template<typename T>
@@ -174,8 +220,16 @@ Q_OUTOFLINE_TEMPLATE RowList<T> Query<T>::toList(int count)
     RowList<T> returnList;
     d->select = "*";
 
+    PhraseList fields;
+    foreach (PhraseData *pd, d->fieldPhrase.data)
+        fields.data.append(pd);
+    const char *key = projectionKey(d->database, d->fieldPhrase);
+    AbstractFieldPhrase keyField(T::staticMetaObject.className(), key ? key : "");
+    if (key)
+        fields.data.append(keyField.data);
+
     d->sql = d->database->sqlGenertor()->selectCommand(
-                d->tableName, d->fieldPhrase, d->wherePhrase, d->orderPhrase,
+                d->tableName, fields, d->wherePhrase, d->orderPhrase,
                 d->relations, d->skip, count);
 
     QSqlQuery q = d->database->exec(d->sql);
@@ -184,19 +238,116 @@ Q_OUTOFLINE_TEMPLATE RowList<T> Query<T>::toList(int count)
         return returnList;
     }
 
+    if (d->noTracking)
+        returnList = readRows(q, d->database, d->tableName, d->relations,
+                              nullptr, nullptr);
+    else
+        returnList = readRows(q, d->database, d->tableName, d->relations,
+                              d->tableSet, this);
+
+#ifndef NUT_SHARED_POINTER
+    if (m_autoDelete)
+        deleteLater();
+#endif
+    return returnList;
+
+}
+
+/*!
+ * \brief Query::compile
+ * Generates select command of this query once and returns a compiled query
+ * that executes it with given arguments.
+ * \sa CompiledQuery
+ */
+template <class T>
+template <typename... Args>
+Q_OUTOFLINE_TEMPLATE CompiledQuery<T, Args...> Query<T>::compile()
+{
+    Q_D(Query);
+
+    PhraseList fields;
+    foreach (PhraseData *pd, d->fieldPhrase.data)
+        fields.data.append(pd);
+    const char *key = projectionKey(d->database, d->fieldPhrase);
+    AbstractFieldPhrase keyField(T::staticMetaObject.className(), key ? key : "");
+    if (key)
+        fields.data.append(keyField.data);
+
+    d->sql = d->database->sqlGenertor()->selectCommand(
+                d->tableName, fields, d->wherePhrase, d->orderPhrase,
+                d->relations, d->skip, d->take);
+
+    QStringList parameters;
+    collectParameters(d->wherePhrase.data, parameters);
+
+    CompiledQuery<T, Args...> ret(d->sql, parameters, d->tableName,
+                                  d->relations);
+
+    if (m_autoDelete)
+        deleteLater();
+    return ret;
+}
+
+/*
+ * Rows of a projection are hydrated only from projected columns and matched
+ * by their key, so key of T is selected when projection does not have it.
+ * Returns name of the key in that case, otherwise null
+ */
+template <class T>
+Q_OUTOFLINE_TEMPLATE const char *Query<T>::projectionKey(Database *database,
+                                                         const PhraseList &fields)
+{
+    if (!fields.data.count())
+        return nullptr;
+
+    const char *className = T::staticMetaObject.className();
+    TableModel *table = database->model().tableByClassName(className);
+    if (!table)
+        return nullptr;
+
+    QString key = table->primaryKey();
+    foreach (const PhraseData *pd, fields.data)
+        if (pd->type == PhraseData::Field
+                && !qstrcmp(pd->className, className)
+                && key == QLatin1String(pd->fieldName))
+            return nullptr;
+
+    int index = T::staticMetaObject.indexOfProperty(key.toLatin1().data());
+    if (index < 0)
+        return nullptr;
+    return T::staticMetaObject.property(index).name();
+}
+
+/*
+ * Creates rows from result of a select command, rows of joined tables are
+ * added to child table sets of their masters. When tableSet is null the
+ * rows are not tracked.
+ */
+template <class T>
+Q_OUTOFLINE_TEMPLATE RowList<T> Query<T>::readRows(QSqlQuery &q,
+                                                   Database *database,
+                                                   const QString &tableName,
+                                                   const QList<RelationModel *> &relations,
+                                                   TableSetBase *tableSet,
+                                                   QObject *parent)
+{
+    RowList<T> returnList;
+
     QSet<TableModel*> relatedTables;
-    relatedTables << d->database->model().tableByName(d->tableName);
-    foreach (RelationModel *rel, d->relations)
+    relatedTables << database->model().tableByName(tableName);
+    foreach (RelationModel *rel, relations)
         relatedTables << rel->slaveTable << rel->masterTable;
 
     struct LevelData{
         QList<int> masters;
         QList<int> slaves;
         QList<QString> masterFields;
-        QString keyFiledname;
+        int keyColumn;
         QVariant lastKeyValue;
         TableModel *table;
         Row<Table> lastRow;
+        QVector<int> columns;
+        QBitArray notLoaded;
     };
     QVector<LevelData> levels;
     QSet<QString> importedTables;
@@ -207,11 +358,11 @@ Q_OUTOFLINE_TEMPLATE RowList<T> Query<T>::toList(int count)
 
         LevelData data;
         data.table = table;
-        data.keyFiledname = data.table->name() + "." + data.table->primaryKey();
+        data.keyColumn = -1;
         data.lastKeyValue = QVariant();
 
         QHash<QString, QString> masters;
-        foreach (RelationModel *rel, d->relations)
+        foreach (RelationModel *rel, relations)
             if (rel->slaveTable->name() == table->name())
                 masters.insert(rel->masterTable->name(), rel->localProperty);
 
@@ -232,21 +383,33 @@ Q_OUTOFLINE_TEMPLATE RowList<T> Query<T>::toList(int count)
 
         levels.append(data);
     };
-    for (int i = 0; i < d->relations.count(); ++i) {
-        RelationModel *rel = d->relations[i];
+    for (int i = 0; i < relations.count(); ++i) {
+        RelationModel *rel = relations[i];
         add_table(i, rel->masterTable);
         add_table(i, rel->slaveTable);
     }
 
     if (!importedTables.count()) {
         LevelData data;
-        data.table = d->database->model().tableByName(d->tableName);
-        data.keyFiledname = d->tableName + "." + data.table->primaryKey();
+        data.table = database->model().tableByName(tableName);
+        data.keyColumn = -1;
         data.lastKeyValue = QVariant();
 
         levels.append(data);
     }
 
+    // Columns are aliased as table.field, except fields of a projection
+    QSqlRecord record = q.record();
+    auto columnIndex = [&](TableModel *table, const QString &field) -> int {
+        int index = record.indexOf(table->name() + "." + field);
+        if (index == -1 && relations.isEmpty())
+            index = record.indexOf(field);
+        return index;
+    };
+    for (int i = 0; i < levels.count(); ++i)
+        levels[i].keyColumn = columnIndex(levels[i].table,
+                                          levels[i].table->primaryKey());
+
     QVector<bool> checked;
     checked.reserve(levels.count());
     for (int i = 0; i < levels.count(); ++i)
@@ -270,9 +433,9 @@ Q_OUTOFLINE_TEMPLATE RowList<T> Query<T>::toList(int count)
             LevelData &data = levels[n];
 
             // check if key value is changed
-            if (data.lastKeyValue == q.value(data.keyFiledname)) {
+            if (data.lastKeyValue == q.value(data.keyColumn)) {
                 --p;
-//                qDebug() << "key os not changed for" << data.keyFiledname;
+//                qDebug() << "key os not changed for" << data.keyColumn;
                 continue;
             }
 
@@ -285,18 +448,19 @@ Q_OUTOFLINE_TEMPLATE RowList<T> Query<T>::toList(int count)
 
             checked[n] = true;
             --p;
-            data.lastKeyValue = q.value(data.keyFiledname);
+            data.lastKeyValue = q.value(data.keyColumn);
 
             //create table row
             Row<Table> row;
-            if (data.table->className() == d->className) {
+            if (data.table->className() == T::staticMetaObject.className()) {
                 row = Nut::create<T>();
 #ifdef NUT_SHARED_POINTER
                 returnList.append(row.objectCast<T>());
 #else
                 returnList.append(dynamic_cast<T*>(table));
 #endif
-                d->tableSet->add(row);
+                if (tableSet)
+                    tableSet->add(row);
 
             } else {
                 Table *table;
@@ -310,12 +474,47 @@ Q_OUTOFLINE_TEMPLATE RowList<T> Query<T>::toList(int count)
                 row = createFrom(table);
             }
 
+            if (!tableSet)
+                row->setTrackChanges(false);
+
             QList<FieldModel*> childFields = data.table->fields();
-            foreach (FieldModel *field, childFields)
-                row->setProperty(field->name.toLatin1().data(),
-                                   d->database->sqlGenertor()->unescapeValue(
-                                       field->type,
-                                       q.value(data.table->name() + "." + field->name)));
+
+            // Columns of result are resolved once per table, values are
+            // written to properties resolved by table model
+            const QMetaObject *rowMetaObject = row->metaObject();
+            if (data.columns.isEmpty()) {
+                foreach (FieldModel *field, childFields) {
+                    int column = columnIndex(data.table, field->name);
+                    data.columns.append(column);
+
+                    // Deferred fields and fields that are not in projection
+                    // are not selected, they are loaded on demand
+                    if (column == -1 && field->propertyIndex > 0) {
+                        if (data.notLoaded.isEmpty())
+                            data.notLoaded.resize(rowMetaObject->propertyCount());
+                        data.notLoaded.setBit(field->propertyIndex);
+                    }
+                }
+            }
+
+            for (int i = 0; i < childFields.count(); ++i) {
+                FieldModel *field = childFields.at(i);
+                if (data.columns.at(i) == -1)
+                    continue;
+
+                QVariant value = database->sqlGenertor()->unescapeValue(
+                            field->type, q.value(data.columns.at(i)));
+
+                if (field->propertyIndex > 0)
+                    rowMetaObject->property(field->propertyIndex)
+                            .write(row.data(), value);
+                else
+                    row->setProperty(field->name.toLatin1().data(), value);
+            }
+
+            if (!data.notLoaded.isEmpty())
+                row->setNotLoaded(data.notLoaded, database, data.table,
+                                  data.lastRow.data());
 
             for (int i = 0; i < data.masters.count(); ++i) {
                 int master = data.masters[i];
@@ -325,20 +524,19 @@ Q_OUTOFLINE_TEMPLATE RowList<T> Query<T>::toList(int count)
             }
 
             row->setStatus(Table::FeatchedFromDB);
-            row->setParent(this);
-            row->clear();
+            if (tableSet) {
+                row->setParent(parent);
+                row->clear();
+                if (database->trackOriginalValues())
+                    row->saveOriginalValues(data.table);
+            }
 
             //set last created row
             data.lastRow = row;
         } //while
     } // while
 
-#ifndef NUT_SHARED_POINTER
-    if (m_autoDelete)
-        deleteLater();
-#endif
     return returnList;
-
 }
 
 template <typename T>
@@ -380,6 +578,99 @@ Q_OUTOFLINE_TEMPLATE Row<T> Query<T>::first()
         return nullptr;
 }
 
+/*!
+ * \brief Query::aggregate
+ * Selects given fields and aggregates in one command and returns a typed
+ * tuple per record. Use with groupBy and having:
+ * \code
+ * auto list = db.posts()->query()
+ *         ->groupBy(Post::authorIdField())
+ *         ->having(Nut::count() > 2)
+ *         ->aggregate(Post::authorIdField(), Nut::count(),
+ *                     Nut::max(Post::scoreField()));
+ * \endcode
+ */
+template <class T>
+template <typename... Ps>
+Q_OUTOFLINE_TEMPLATE QList<std::tuple<typename PhraseValueType<Ps>::type...> >
+Query<T>::aggregate(const Ps &... phrases)
+{
+    PhraseList fields;
+    PhraseData *datas[] = { phrases.data... };
+    for (PhraseData *data : datas)
+        fields.data.append(data);
+
+    return selectTuples<typename PhraseValueType<Ps>::type...>(fields);
+}
+
+/*!
+ * \brief Query::select
+ * Selects only given fields, each record is read into a tuple without
+ * creating table rows.
+ * \code
+ * auto list = db.posts()->query()
+ *         ->select(Post::idField(), Post::titleField());
+ * foreach (auto t, list)
+ *     qDebug() << std::get<0>(t) << std::get<1>(t);
+ * \endcode
+ */
+template <class T>
+template <typename P1, typename P2, typename... Ps>
+Q_OUTOFLINE_TEMPLATE QList<std::tuple<typename PhraseValueType<P1>::type,
+                                      typename PhraseValueType<P2>::type,
+                                      typename PhraseValueType<Ps>::type...> >
+Query<T>::select(const P1 &p1, const P2 &p2, const Ps &... phrases)
+{
+    return aggregate(p1, p2, phrases...);
+}
+
+/*!
+ * \brief Query::selectAs
+ * Like select, but creates a S for each record. S is a plain struct
+ * that its members are in the order of given fields.
+ * \code
+ * struct PostTitle { int id; QString title; };
+ * auto list = db.posts()->query()
+ *         ->selectAs<PostTitle>(Post::idField(), Post::titleField());
+ * \endcode
+ */
+template <class T>
+template <typename S, typename... Ps>
+Q_OUTOFLINE_TEMPLATE QList<S> Query<T>::selectAs(const Ps &... phrases)
+{
+    QList<S> ret;
+    auto list = aggregate(phrases...);
+    ret.reserve(list.count());
+    foreach (auto t, list)
+        ret.append(makeFromTuple<S>(t));
+    return ret;
+}
+
+template <class T>
+template <typename... Ts>
+Q_OUTOFLINE_TEMPLATE QList<std::tuple<Ts...> >
+Query<T>::selectTuples(const PhraseList &fields)
+{
+    Q_D(Query);
+    QList<std::tuple<Ts...> > ret;
+
+    d->sql = d->database->sqlGenertor()->selectCommand(
+                d->tableName, fields, d->wherePhrase, d->orderPhrase,
+                d->relations, d->skip, d->take,
+                d->groupPhrase, d->havingPhrase);
+
+    QSqlQuery q = d->database->exec(d->sql);
+    if (q.lastError().isValid())
+        qDebug() << q.lastError().text();
+
+    while (q.next())
+        ret.append(readTuple<Ts...>(d->database->sqlGenertor(), q));
+
+    if (m_autoDelete)
+        deleteLater();
+    return ret;
+}
+
 template <class T>
 Q_OUTOFLINE_TEMPLATE int Query<T>::count()
 {
@@ -531,6 +822,42 @@ Q_OUTOFLINE_TEMPLATE Query<T> *Query<T>::setWhere(const ConditionalPhrase &ph)
     return this;
 }
 
+/*!
+ * \brief Query::asNoTracking
+ * Rows returned by this query are read only, they are not added to the
+ * table set, have no parent and changes of them are not tracked. So they
+ * can not be saved by Database::saveChanges.
+ * When NUT_SHARED_POINTER is not defined rows are plain pointers and
+ * nothing owns them, so caller must delete them (e.g. by qDeleteAll)
+ * when they are not used anymore.
+ */
+template<class T>
+Q_OUTOFLINE_TEMPLATE Query<T> *Query<T>::asNoTracking()
+{
+    Q_D(Query);
+    d->noTracking = true;
+    return this;
+}
+
+template<class T>
+Q_OUTOFLINE_TEMPLATE Query<T> *Query<T>::groupBy(const PhraseList &ph)
+{
+    Q_D(Query);
+    d->groupPhrase = ph;
+    return this;
+}
+
+template<class T>
+Q_OUTOFLINE_TEMPLATE Query<T> *Query<T>::having(const ConditionalPhrase &ph)
+{
+    Q_D(Query);
+    if (d->havingPhrase.data)
+        d->havingPhrase = d->havingPhrase && ph;
+    else
+        d->havingPhrase = ph;
+    return this;
+}
+
 template<class T>
 Q_OUTOFLINE_TEMPLATE Query<T> *Query<T>::skip(int n)
 {
@@ -646,41 +973,192 @@ Q_OUTOFLINE_TEMPLATE void Query<T>::toModel(QSqlQueryModel *model)
     }
 }
 
+/*!
+ * \brief Query::toModel
+ * Binds the model to this query. Rows are read page by page when view asks
+ * for them (canFetchMore/fetchMore) and row count is read by a COUNT(*)
+ * command. Pages are read by keyset over order fields of this table and
+ * primary key, queries that ordered by other phrases or by columns that
+ * accept NULL are read by offset.
+ * Sorting and filtering of the model are added to order and where of this
+ * query and done by database. Rows of the model are not tracked. Queries
+ * with skip, take or joins are loaded at once.
+ */
 template<class T>
 Q_OUTOFLINE_TEMPLATE void Query<T>::toModel(SqlModel *model)
 {
     Q_D(Query);
 
-    d->sql = d->database->sqlGenertor()->selectCommand(
-                d->tableName,
-                d->fieldPhrase,
-                d->wherePhrase, d->orderPhrase, d->relations,
-                d->skip, d->take);
+    if (d->skip != -1 || d->take != -1 || d->relations.count()) {
+        model->setTable(toList());
+        return;
+    }
 
-    model->setTable(toList());
-    /*
-    DatabaseModel dbModel = d->database->model();
-    model->setQuery(d->sql, d->database->database());
+    Database *database = d->database;
+    TableSetBase *tableSet = d->tableSet;
+    ConditionalPhrase where = d->wherePhrase;
+    PhraseDataList orderData = d->orderPhrase.data;
+    PhraseDataList fieldsData = d->fieldPhrase.data;
+
+    auto bind = [=](int column, Qt::SortOrder sortOrder,
+                    const ConditionalPhrase &filter) {
+        ConditionalPhrase w = where;
+        if (filter.data)
+            w = w.data ? (w && filter) : filter;
+
+        TableModel *table = database->model()
+                .tableByClassName(T::staticMetaObject.className());
+        FieldModel *field = column >= 0 ? table->field(column) : nullptr;
+        int index = field
+                ? T::staticMetaObject.indexOfProperty(field->name.toLatin1().data())
+                : -1;
+
+        if (index < 0) {
+            bindModel(model, database, tableSet, w, orderData, fieldsData);
+            return;
+        }
 
-    int fieldIndex = 0;
+        AbstractFieldPhrase sortField(T::staticMetaObject.className(),
+                                      T::staticMetaObject.property(index).name());
+        sortField.data->isNot = sortOrder == Qt::DescendingOrder;
+        PhraseDataList order;
+        order.append(sortField.data);
+        bindModel(model, database, tableSet, w, order, fieldsData);
+    };
 
-    if (d->fieldPhrase.data.count()) {
-        foreach (const PhraseData *pd, d->fieldPhrase.data) {
-            QString displayName = dbModel.tableByClassName(pd->className)
-                    ->field(pd->fieldName)->displayName;
+    model->setBinder(bind);
 
-            model->setHeaderData(fieldIndex++,
-                                 Qt::Horizontal,
-                                 displayName);
+    if (m_autoDelete)
+        deleteLater();
+}
+
+template<class T>
+Q_OUTOFLINE_TEMPLATE void Query<T>::bindModel(SqlModel *model,
+                                              Database *database,
+                                              TableSetBase *tableSet,
+                                              const ConditionalPhrase &where,
+                                              const PhraseDataList &orderData,
+                                              const PhraseDataList &fieldsData)
+{
+    const char *className = T::staticMetaObject.className();
+    TableModel *table = database->model().tableByClassName(className);
+    FieldModel *pk = table->field(table->primaryKey());
+
+    QList<const char*> keyNames;
+    QList<bool> keyDescending;
+    QStringList keyFields;
+    bool keyset = pk != nullptr;
+    foreach (const PhraseData *pd, orderData) {
+        if (pd->type != PhraseData::Field || qstrcmp(pd->className, className)) {
+            keyset = false;
+            break;
         }
-    } else {
-        TableModel *tbl = d->database->model().tableByName(d->tableName);
-        foreach (FieldModel *f, tbl->fields()) {
-            model->setHeaderData(fieldIndex++,
-                                 Qt::Horizontal,
-                                 f->displayName);
+
+        // NULL values are not matched by comparing with last key and their
+        // position differs between databases
+        FieldModel *f = table->field(pd->fieldName);
+        if (!f || !(f->isPrimaryKey || f->notNull)) {
+            keyset = false;
+            break;
         }
-    }*/
+        keyNames.append(pd->fieldName);
+        keyDescending.append(pd->isNot);
+        keyFields.append(pd->fieldName);
+    }
+
+    bool orderByKey = false;
+    if (keyset && !keyFields.contains(pk->name)) {
+        int index = T::staticMetaObject.indexOfProperty(pk->name.toLatin1().data());
+        if (index < 0) {
+            keyset = false;
+        } else {
+            keyNames.append(T::staticMetaObject.property(index).name());
+            keyDescending.append(false);
+            keyFields.append(pk->name);
+            orderByKey = true;
+        }
+    }
+    if (!keyset) {
+        keyNames.clear();
+        keyDescending.clear();
+        keyFields.clear();
+    }
+
+    auto fetch = [=](const QVariantList &after, int skip, int take)
+            -> RowList<Table> {
+        Query<T> q(database, tableSet, false);
+        q.asNoTracking();
+
+        PhraseList fields;
+        foreach (PhraseData *pd, fieldsData)
+            fields.data.append(pd);
+        q.fields(fields);
+
+        PhraseList order;
+        foreach (PhraseData *pd, orderData)
+            order.data.append(pd);
+        if (orderByKey) {
+            AbstractFieldPhrase key(className, keyNames.last());
+            order.data.append(key.data);
+        }
+        q.orderBy(order);
+
+        if (where.data)
+            q.where(where);
+        if (after.isEmpty())
+            q.skip(skip);
+        else
+            q.where(keysetPhrase(className, keyNames, keyDescending, after));
+
+        RowList<Table> ret;
+        foreach (Row<T> row, q.toList(take)) {
+#ifndef NUT_SHARED_POINTER
+            // untracked rows have no owner, they are released with model
+            row->setParent(model);
+#endif
+            ret.append(row);
+        }
+        return ret;
+    };
+
+    auto count = [=]() -> int {
+        Query<T> q(database, tableSet, false);
+        if (where.data)
+            q.where(where);
+        return q.count();
+    };
+
+    model->setSource(fetch, count, keyFields);
+}
+
+/*
+ * Creates condition of rows that come after given key values in order of
+ * key fields, e.g. for (a, b): a > :a OR (a = :a AND b > :b)
+ */
+template <class T>
+Q_OUTOFLINE_TEMPLATE ConditionalPhrase Query<T>::keysetPhrase(
+        const char *className, const QList<const char*> &names,
+        const QList<bool> &descending, const QVariantList &values)
+{
+    ConditionalPhrase ret;
+    for (int i = 0; i < names.count(); ++i) {
+        AbstractFieldPhrase field(className, names.at(i));
+        ConditionalPhrase term(&field,
+                               descending.at(i) ? PhraseData::Less
+                                                : PhraseData::Greater,
+                               values.at(i));
+
+        for (int j = i - 1; j >= 0; --j) {
+            AbstractFieldPhrase prior(className, names.at(j));
+            term = (prior == values.at(j)) && term;
+        }
+
+        if (ret.data)
+            ret = ret || term;
+        else
+            ret = term;
+    }
+    return ret;
 }
 
 template <class T>
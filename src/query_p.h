@@ -51,8 +51,9 @@ public:
     QList<RelationModel*> relations;
     int skip;
     int take;
-    PhraseList orderPhrase, fieldPhrase;
-    ConditionalPhrase wherePhrase;
+    bool noTracking;
+    PhraseList orderPhrase, fieldPhrase, groupPhrase;
+    ConditionalPhrase wherePhrase, havingPhrase;
 };
 
 NUT_END_NAMESPACE
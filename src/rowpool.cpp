@@ -0,0 +1,169 @@
+/**************************************************************************
+**
+** This file is part of Nut project.
+** https://github.com/HamedMasafi/Nut
+**
+** Nut is free software: you can redistribute it and/or modify
+** it under the terms of the GNU Lesser General Public License as published by
+** the Free Software Foundation, either version 3 of the License, or
+** (at your option) any later version.
+**
+** Nut is distributed in the hope that it will be useful,
+** but WITHOUT ANY WARRANTY; without even the implied warranty of
+** MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+** GNU Lesser General Public License for more details.
+**
+** You should have received a copy of the GNU Lesser General Public License
+** along with Nut.  If not, see <http://www.gnu.org/licenses/>.
+**
+**************************************************************************/
+
+#include <new>
+
+#include "rowpool_p.h"
+
+// Maximum count of released blocks kept per size and thread, zero disables
+// recycling
+#ifndef NUT_ROW_POOL_SIZE
+#   define NUT_ROW_POOL_SIZE 1024
+#endif
+
+#define __NUT_ROW_POOL_ALIGN 16
+#define __NUT_ROW_POOL_BUCKETS 64
+
+NUT_BEGIN_NAMESPACE
+
+namespace {
+
+struct FreeBlock
+{
+    FreeBlock *next;
+};
+
+struct Bucket
+{
+    FreeBlock *head;
+    int count;
+};
+
+// Free lists are trivially destructible, so they stay valid while other
+// thread local objects are destroyed. Blocks are returned to the global
+// allocator by the cleaner, after that the pool is closed for the thread.
+thread_local Bucket buckets[__NUT_ROW_POOL_BUCKETS];
+thread_local bool poolClosed = false;
+thread_local bool poolEnabled = true;
+thread_local bool cleanerCreated = false;
+
+struct PoolCleaner
+{
+    void create()
+    {
+        cleanerCreated = true;
+    }
+
+    ~PoolCleaner()
+    {
+        for (int i = 0; i < __NUT_ROW_POOL_BUCKETS; ++i) {
+            while (buckets[i].head) {
+                FreeBlock *b = buckets[i].head;
+                buckets[i].head = b->next;
+                ::operator delete(b);
+            }
+            buckets[i].count = 0;
+        }
+
+        // rows released after this go to the global allocator
+        poolClosed = true;
+    }
+};
+
+thread_local PoolCleaner cleaner;
+
+inline int bucketIndex(std::size_t size)
+{
+    return static_cast<int>((size + __NUT_ROW_POOL_ALIGN - 1)
+                            / __NUT_ROW_POOL_ALIGN) - 1;
+}
+
+}
+
+void *RowPool::allocate(std::size_t size)
+{
+    int i = bucketIndex(size);
+    if (NUT_ROW_POOL_SIZE <= 0 || i < 0 || i >= __NUT_ROW_POOL_BUCKETS)
+        return ::operator new(size);
+
+    Bucket &bucket = buckets[i];
+    if (bucket.head) {
+        FreeBlock *b = bucket.head;
+        bucket.head = b->next;
+        --bucket.count;
+        return b;
+    }
+
+    // Blocks of a bucket are allocated with same size, so any of them can
+    // be reused for another row of the bucket
+    return ::operator new(static_cast<std::size_t>(i + 1) * __NUT_ROW_POOL_ALIGN);
+}
+
+void RowPool::release(void *p, std::size_t size)
+{
+    if (!p)
+        return;
+
+    int i = bucketIndex(size);
+    if (NUT_ROW_POOL_SIZE <= 0 || i < 0 || i >= __NUT_ROW_POOL_BUCKETS) {
+        ::operator delete(p);
+        return;
+    }
+
+    Bucket &bucket = buckets[i];
+    if (poolClosed || !poolEnabled || bucket.count >= NUT_ROW_POOL_SIZE) {
+        ::operator delete(p);
+        return;
+    }
+
+    // Cleaner is created by first block kept in the pool of a thread
+    if (!cleanerCreated)
+        cleaner.create();
+
+    FreeBlock *b = static_cast<FreeBlock*>(p);
+    b->next = bucket.head;
+    bucket.head = b;
+    ++bucket.count;
+}
+
+bool RowPool::isEnabled()
+{
+    return NUT_ROW_POOL_SIZE > 0 && poolEnabled;
+}
+
+/*
+ * Blocks are allocated with size of their bucket also while recycling is
+ * disabled, so released blocks can be kept after it is enabled again
+ */
+void RowPool::setEnabled(bool enabled)
+{
+    poolEnabled = enabled;
+    if (!enabled)
+        trim(0);
+}
+
+/*
+ * Returns released blocks of current thread to the global allocator until
+ * at most keep blocks of each size are left
+ */
+void RowPool::trim(int keep)
+{
+    for (int i = 0; i < __NUT_ROW_POOL_BUCKETS; ++i) {
+        Bucket &bucket = buckets[i];
+        while (bucket.head && bucket.count > keep) {
+            FreeBlock *b = bucket.head;
+            bucket.head = b->next;
+            --bucket.count;
+            ::operator delete(b);
+        }
+    }
+}
+
+NUT_END_NAMESPACE
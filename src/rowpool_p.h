@@ -0,0 +1,56 @@
+/**************************************************************************
+**
+** This file is part of Nut project.
+** https://github.com/HamedMasafi/Nut
+**
+** Nut is free software: you can redistribute it and/or modify
+** it under the terms of the GNU Lesser General Public License as published by
+** the Free Software Foundation, either version 3 of the License, or
+** (at your option) any later version.
+**
+** Nut is distributed in the hope that it will be useful,
+** but WITHOUT ANY WARRANTY; without even the implied warranty of
+** MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+** GNU Lesser General Public License for more details.
+**
+** You should have received a copy of the GNU Lesser General Public License
+** along with Nut.  If not, see <http://www.gnu.org/licenses/>.
+**
+**************************************************************************/
+
+#ifndef ROWPOOL_P_H
+#define ROWPOOL_P_H
+
+#include <cstddef>
+
+#include "defines.h"
+
+// Count of released blocks per size that are kept when table sets are
+// cleared
+#ifndef __NUT_ROW_POOL_TRIM_SIZE
+#   define __NUT_ROW_POOL_TRIM_SIZE 64
+#endif
+
+NUT_BEGIN_NAMESPACE
+
+/*
+ * Recycles memory of table rows. Blocks are grouped by their size and
+ * released blocks are kept in a per thread free list, so hydrating rows
+ * of a query reuses memory of rows that were freed before instead of
+ * calling the global allocator for each one. Recycling can be disabled
+ * and kept blocks can be freed at runtime, both for current thread.
+ */
+class RowPool
+{
+public:
+    static void *allocate(std::size_t size);
+    static void release(void *p, std::size_t size);
+
+    static bool isEnabled();
+    static void setEnabled(bool enabled);
+    static void trim(int keep = 0);
+};
+
+NUT_END_NAMESPACE
+
+#endif // ROWPOOL_P_H
@@ -18,6 +18,8 @@
 **
 **************************************************************************/
 
+#include <QMetaProperty>
+
 #include "database.h"
 #include "tablesetbase_p.h"
 #include "databasemodel.h"
@@ -27,6 +29,14 @@
 #include "sqlmodel.h"
 #include "query.h"
 
+#ifndef __NUT_MODEL_PAGE_SIZE
+#   define __NUT_MODEL_PAGE_SIZE 256
+#endif
+
+#ifndef __NUT_MODEL_CACHED_PAGES
+#   define __NUT_MODEL_CACHED_PAGES 8
+#endif
+
 NUT_BEGIN_NAMESPACE
 
 //SqlModel::SqlModel(Query *q) : QAbstractItemModel(q.)
@@ -46,6 +56,13 @@ SqlModel::SqlModel(Database *database, TableSetBase *tableSet, QObject *parent)
             .tableByClassName(tableSet->childClassName());
     d->tableName = d->model->name();
 
+    // Properties are read by index, names are used for fields that have no
+    // resolved index
+    foreach (FieldModel *f, d->model->fields()) {
+        d->columns.append(f->propertyIndex > 0 ? f->propertyIndex : -1);
+        d->columnNames.append(f->name.toLatin1());
+    }
+
 
     //     setQuery("SELECT * FROM " + d->tableName, database->databaseName());
 }
@@ -53,6 +70,8 @@ SqlModel::SqlModel(Database *database, TableSetBase *tableSet, QObject *parent)
 int SqlModel::rowCount(const QModelIndex &parent) const
 {
     Q_UNUSED(parent);
+    if (d->isPaged())
+        return d->fetchedCount;
     return d->rows.count();
 }
 
@@ -67,12 +86,11 @@ QVariant SqlModel::data(const QModelIndex &index, int role) const
     if (!index.isValid())
         return QVariant();
 
-    if (index.row() >= d->rows.count() || index.row() < 0)
+    if (index.row() >= rowCount(QModelIndex()) || index.row() < 0)
         return QVariant("-");
 
     if (role == Qt::DisplayRole) {
-        Row<Table> t = d->rows.at(index.row());
-        QVariant v = t->property(d->model->field(index.column())->name.toLocal8Bit().data());
+        QVariant v = d->value(index.row(), index.column());
 
         if (_renderer != nullptr)
             v = _renderer(index.column(), v);
@@ -81,21 +99,348 @@ QVariant SqlModel::data(const QModelIndex &index, int role) const
     return QVariant();
 }
 
+/*!
+ * \brief SqlModel::canFetchMore
+ * \return true when model is bound to a query and rows that counted by it
+ * are not fetched yet
+ */
+bool SqlModel::canFetchMore(const QModelIndex &parent) const
+{
+    if (parent.isValid() || !d->isPaged())
+        return false;
+    return d->fetchedCount < d->totalCount;
+}
+
+void SqlModel::fetchMore(const QModelIndex &parent)
+{
+    if (!canFetchMore(parent))
+        return;
+
+    RowList<Table> rows = d->loadPage(d->fetchedCount / d->pageSize);
+
+    // Some rows are removed since counting
+    if (rows.count() < d->pageSize)
+        d->totalCount = d->fetchedCount + rows.count();
+
+    if (rows.isEmpty())
+        return;
+
+    beginInsertRows(QModelIndex(), d->fetchedCount,
+                    d->fetchedCount + rows.count() - 1);
+    d->fetchedCount += rows.count();
+    foreach (Row<Table> row, rows)
+        d->rowKeys.append(row->primaryValue());
+    endInsertRows();
+}
+
+int SqlModel::pageSize() const
+{
+    return d->pageSize;
+}
+
+void SqlModel::setPageSize(int pageSize)
+{
+    pageSize = qMax(1, pageSize);
+    if (d->pageSize == pageSize)
+        return;
+
+    beginResetModel();
+    d->pageSize = pageSize;
+    if (d->isPaged())
+        d->resetPages();
+    endResetModel();
+}
+
+/*!
+ * \brief SqlModel::cachedPages
+ * \return Count of pages that kept in memory, pages that are far from
+ * the last requested row are released and read again when needed
+ */
+int SqlModel::cachedPages() const
+{
+    return d->cachedPages;
+}
+
+void SqlModel::setCachedPages(int cachedPages)
+{
+    d->cachedPages = qMax(1, cachedPages);
+}
+
+/*!
+ * \brief SqlModel::totalCount
+ * \return Count of rows of the bound query, rowCount reaches this value
+ * after all rows are fetched
+ */
+int SqlModel::totalCount() const
+{
+    if (d->isPaged())
+        return d->totalCount;
+    return d->rows.count();
+}
+
+/*!
+ * \brief SqlModel::sort
+ * Orders rows of the bound query by given column, sorting is done by
+ * database and rows are fetched again. Column -1 restores order of query.
+ */
+void SqlModel::sort(int column, Qt::SortOrder order)
+{
+    d->sortColumn = column;
+    d->sortOrder = order;
+    if (d->bind)
+        d->bind(d->sortColumn, d->sortOrder, d->filter);
+}
+
+ConditionalPhrase SqlModel::filter() const
+{
+    return d->filter;
+}
+
+/*!
+ * \brief SqlModel::setFilter
+ * Adds given condition to where of the bound query and fetches rows again,
+ * an empty phrase removes the filter.
+ */
+void SqlModel::setFilter(const ConditionalPhrase &filter)
+{
+    d->filter = filter;
+    if (d->bind)
+        d->bind(d->sortColumn, d->sortOrder, d->filter);
+}
+
+/*!
+ * \brief SqlModel::isValueCacheEnabled
+ * \return true if values shown by data() are kept per column, values are
+ * released when rows of model change. Changes that made to row objects
+ * directly are shown after refresh() or setRows().
+ */
+bool SqlModel::isValueCacheEnabled() const
+{
+    return d->cacheValues;
+}
+
+void SqlModel::setValueCacheEnabled(bool enabled)
+{
+    d->cacheValues = enabled;
+    d->clearValues();
+}
+
+void SqlModel::setBinder(const SqlModelPrivate::BindFunction &bind)
+{
+    d->bind = bind;
+    d->sortColumn = -1;
+    d->sortOrder = Qt::AscendingOrder;
+    d->filter = ConditionalPhrase();
+    d->bind(d->sortColumn, d->sortOrder, d->filter);
+}
+
+void SqlModel::setSource(const SqlModelPrivate::FetchFunction &fetch,
+                         const SqlModelPrivate::CountFunction &count,
+                         const QStringList &keyFields)
+{
+    beginResetModel();
+    d.detach();
+    d->rows.clear();
+    d->fetch = fetch;
+    d->count = count;
+    d->keyFields = keyFields;
+    d->resetPages();
+    endResetModel();
+}
+
+/*!
+ * \brief SqlModel::setRows
+ * Replaces rows of model, rows are matched by primary key and only
+ * inserted, removed, moved and changed rows are reported to views.
+ */
 void SqlModel::setRows(RowList<Table> rows)
 {
     d.detach();
-    if (d->rows.count()) {
-        beginRemoveRows(QModelIndex(), 0, d->rows.count());
-        d->rows.clear();
-        endRemoveRows();
+    if (!d->isPaged() && SqlModelPrivate::isKeysUnique(d->rows)
+            && SqlModelPrivate::isKeysUnique(rows)) {
+        QVariantList keys;
+        foreach (Row<Table> row, d->rows)
+            keys.append(row->primaryValue());
+        updateRows(keys, rows);
+        return;
     }
-    beginInsertRows(QModelIndex(), 0, rows.count());
+
+    int count = rowCount(QModelIndex());
+    if (count)
+        beginRemoveRows(QModelIndex(), 0, count - 1);
+    d->rows.clear();
+    d->bind = nullptr;
+    d->fetch = nullptr;
+    d->count = nullptr;
+    d->keyFields.clear();
+    d->resetPages();
+    if (count)
+        endRemoveRows();
+
+    if (rows.isEmpty())
+        return;
+
+    beginInsertRows(QModelIndex(), 0, rows.count() - 1);
     d->rows = rows;
     endInsertRows();
 }
 
+/*!
+ * \brief SqlModel::refresh
+ * Runs the bound query again for fetched rows. Rows are matched by primary
+ * key, so selection and scroll position of views are kept and only changed
+ * ranges are repainted.
+ */
+void SqlModel::refresh()
+{
+    if (!d->isPaged())
+        return;
+
+    RowList<Table> current;
+    for (int i = 0; i < d->fetchedCount; ++i) {
+        int page = i / d->pageSize;
+        int n = i % d->pageSize;
+        if (d->pages.contains(page) && n < d->pages[page].count())
+            current.append(d->pages[page].at(n));
+        else
+            current.append(Row<Table>());
+    }
+    QVariantList keys = d->rowKeys;
+
+    int total = d->count();
+    d->pages.clear();
+    d->pageKeys.clear();
+    RowList<Table> rows;
+    for (int page = 0; rows.count() < d->fetchedCount; ++page) {
+        RowList<Table> pageRows = d->loadPage(page);
+        rows.append(pageRows);
+        if (pageRows.count() < d->pageSize)
+            break;
+    }
+
+    if (!SqlModelPrivate::isKeysUnique(rows)) {
+        beginResetModel();
+        d->resetPages();
+        endResetModel();
+        return;
+    }
+
+    // Rows are updated as an in-memory list, then pages are used again
+    SqlModelPrivate::FetchFunction fetch = d->fetch;
+    d->fetch = nullptr;
+    d->rows = current;
+    updateRows(keys, rows);
+    d->rows.clear();
+    d->fetch = fetch;
+
+    d->rowKeys.clear();
+    foreach (Row<Table> row, rows)
+        d->rowKeys.append(row->primaryValue());
+    d->fetchedCount = rows.count();
+    d->totalCount = qMax(total, rows.count());
+}
+
+/*
+ * Changes d->rows to given rows, keys are primary keys of current rows.
+ * Rows that do not exist anymore are removed, then rows are moved or
+ * inserted in new order, and rows that their values differ are reported
+ * by dataChanged in contiguous ranges
+ */
+void SqlModel::updateRows(QVariantList keys, const RowList<Table> &rows)
+{
+    QSet<QString> newKeys;
+    foreach (Row<Table> row, rows)
+        newKeys.insert(row->primaryValue().toString());
+
+    for (int i = keys.count() - 1; i >= 0; --i) {
+        if (newKeys.contains(keys.at(i).toString()))
+            continue;
+
+        int last = i;
+        while (i > 0 && !newKeys.contains(keys.at(i - 1).toString()))
+            --i;
+
+        beginRemoveRows(QModelIndex(), i, last);
+        for (int n = last; n >= i; --n) {
+            d->rows.removeAt(n);
+            keys.removeAt(n);
+        }
+        d->removeValues(i, last);
+        endRemoveRows();
+    }
+
+    QSet<QString> currentKeys;
+    foreach (const QVariant &key, keys)
+        currentKeys.insert(key.toString());
+
+    int changedFirst = -1;
+    int changedLast = -1;
+    auto flushChanged = [&]() {
+        if (changedFirst == -1)
+            return;
+        emit dataChanged(index(changedFirst, 0),
+                         index(changedLast, columnCount(QModelIndex()) - 1));
+        changedFirst = changedLast = -1;
+    };
+
+    for (int i = 0; i < rows.count(); ++i) {
+        QString key = rows.at(i)->primaryValue().toString();
+
+        if (!currentKeys.contains(key)) {
+            flushChanged();
+            int last = i;
+            while (last + 1 < rows.count()
+                   && !currentKeys.contains(rows.at(last + 1)->primaryValue().toString()))
+                ++last;
+
+            beginInsertRows(QModelIndex(), i, last);
+            for (int n = i; n <= last; ++n) {
+                d->rows.insert(n, rows.at(n));
+                keys.insert(n, rows.at(n)->primaryValue());
+            }
+            d->insertValues(i, last - i + 1);
+            endInsertRows();
+            i = last;
+            continue;
+        }
+
+        if (keys.at(i).toString() != key) {
+            flushChanged();
+            int from = i + 1;
+            while (keys.at(from).toString() != key)
+                ++from;
+
+            beginMoveRows(QModelIndex(), from, from, QModelIndex(), i);
+            d->rows.move(from, i);
+            keys.move(from, i);
+            d->moveValue(from, i);
+            endMoveRows();
+        }
+
+        Row<Table> old = d->rows.at(i);
+        d->rows[i] = rows.at(i);
+        bool changed = old && d->isChanged(old, rows.at(i));
+        if (changed || !old)
+            d->invalidateValues(i, i);
+        if (changed) {
+            if (changedFirst == -1)
+                changedFirst = i;
+            changedLast = i;
+        } else {
+            flushChanged();
+        }
+    }
+    flushChanged();
+}
+
 void SqlModel::append(Row<Table> table)
 {
+    if (d->isPaged()) {
+        qWarning("SqlModel: Rows can not be appended to a model that is "
+                 "bound to a query");
+        return;
+    }
+
     d.detach();
     beginInsertRows(QModelIndex(), d->rows.count(), d->rows.count());
     d->rows.append(table);
@@ -117,12 +462,192 @@ QVariant SqlModel::headerData(int section, Qt::Orientation orientation, int role
 
 Row<Table> SqlModel::at(const int &i) const
 {
-    return d->rows.at(i);
+    return d->row(i);
+}
+
+SqlModelPrivate::SqlModelPrivate(SqlModel *parent) : model(nullptr),
+    cacheValues(false), sortColumn(-1), sortOrder(Qt::AscendingOrder),
+    pageSize(__NUT_MODEL_PAGE_SIZE), cachedPages(__NUT_MODEL_CACHED_PAGES),
+    totalCount(0), fetchedCount(0)
+{
+    Q_UNUSED(parent);
+}
+
+bool SqlModelPrivate::isPaged() const
+{
+    return fetch != nullptr;
+}
+
+void SqlModelPrivate::resetPages()
+{
+    pages.clear();
+    pageKeys.clear();
+    rowKeys.clear();
+    clearValues();
+    fetchedCount = 0;
+    totalCount = count ? count() : 0;
+}
+
+/*
+ * Reads a page by key values of last row of previous page when they are
+ * known, key of last row of each page is kept after first read, so an
+ * evicted page is read again by the same key
+ */
+RowList<Table> SqlModelPrivate::loadPage(int page)
+{
+    if (pages.contains(page))
+        return pages.value(page);
+
+    QVariantList after;
+    if (page > 0 && page <= pageKeys.count())
+        after = pageKeys.at(page - 1);
+
+    RowList<Table> ret = fetch(after, page * pageSize, pageSize);
+
+    if (pageKeys.count() == page) {
+        QVariantList keys;
+        if (!ret.isEmpty()) {
+            Row<Table> last = ret.last();
+            foreach (const QString &f, keyFields) {
+                QVariant v = last->property(f.toLatin1().data());
+
+                // Key values that are not read (not in selected fields) can
+                // not be compared, next page is read by offset
+                if (v.isNull()) {
+                    keys.clear();
+                    break;
+                }
+                keys.append(v);
+            }
+        }
+        pageKeys.append(keys);
+    }
+
+    pages.insert(page, ret);
+    while (pages.count() > cachedPages) {
+        int farthest = page;
+        QMap<int, RowList<Table>>::const_iterator i;
+        for (i = pages.constBegin(); i != pages.constEnd(); ++i)
+            if (qAbs(i.key() - page) > qAbs(farthest - page))
+                farthest = i.key();
+        pages.remove(farthest);
+    }
+    return ret;
+}
+
+QVariant SqlModelPrivate::value(int i, int column)
+{
+    if (column < 0 || column >= columns.count())
+        return QVariant();
+
+    if (cacheValues && column < values.count()
+            && i < values.at(column).count() && values.at(column).at(i).isValid())
+        return values.at(column).at(i);
+
+    Row<Table> t = row(i);
+    if (!t)
+        return QVariant();
+
+    QVariant v;
+    if (columns.at(column) > 0)
+        v = t->metaObject()->property(columns.at(column)).read(t.data());
+    else
+        v = t->property(columnNames.at(column).constData());
+
+    if (cacheValues) {
+        if (values.count() != columns.count())
+            values.resize(columns.count());
+        if (values.at(column).count() <= i)
+            values[column].resize(i + 1);
+        values[column][i] = v;
+    }
+    return v;
+}
+
+void SqlModelPrivate::clearValues()
+{
+    values.clear();
+}
+
+void SqlModelPrivate::invalidateValues(int first, int last)
+{
+    for (int c = 0; c < values.count(); ++c)
+        for (int i = first; i <= last && i < values.at(c).count(); ++i)
+            values[c][i] = QVariant();
+}
+
+void SqlModelPrivate::insertValues(int first, int count)
+{
+    for (int c = 0; c < values.count(); ++c)
+        if (first < values.at(c).count())
+            values[c].insert(first, count, QVariant());
+}
+
+void SqlModelPrivate::removeValues(int first, int last)
+{
+    for (int c = 0; c < values.count(); ++c)
+        if (first < values.at(c).count())
+            values[c].remove(first, qMin(last, values.at(c).count() - 1) - first + 1);
+}
+
+void SqlModelPrivate::moveValue(int from, int to)
+{
+    for (int c = 0; c < values.count(); ++c) {
+        QVector<QVariant> &column = values[c];
+        if (qMax(from, to) >= column.count())
+            column.resize(qMax(from, to) + 1);
+        QVariant v = column.at(from);
+        column.remove(from);
+        column.insert(to, v);
+    }
+}
+
+bool SqlModelPrivate::isKeysUnique(const RowList<Table> &rows)
+{
+    QSet<QString> keys;
+    foreach (Row<Table> row, rows) {
+        QVariant key = row->primaryValue();
+        if (key.isNull() || keys.contains(key.toString()))
+            return false;
+        keys.insert(key.toString());
+    }
+    return true;
+}
+
+bool SqlModelPrivate::isChanged(const Row<Table> &oldRow,
+                                const Row<Table> &newRow) const
+{
+    if (oldRow == newRow)
+        return false;
+
+    for (int c = 0; c < columns.count(); ++c) {
+        if (columns.at(c) > 0) {
+            // Reading a deferred value that is not loaded would load it
+            if (!oldRow->isPropertyLoaded(columns.at(c))
+                    || !newRow->isPropertyLoaded(columns.at(c)))
+                continue;
+
+            QMetaProperty p = oldRow->metaObject()->property(columns.at(c));
+            if (p.read(oldRow.data()) != p.read(newRow.data()))
+                return true;
+        } else if (oldRow->property(columnNames.at(c).constData())
+                   != newRow->property(columnNames.at(c).constData())) {
+            return true;
+        }
+    }
+    return false;
 }
 
-SqlModelPrivate::SqlModelPrivate(SqlModel *parent)
+Row<Table> SqlModelPrivate::row(int i)
 {
+    if (!isPaged())
+        return rows.at(i);
 
+    RowList<Table> page = loadPage(i / pageSize);
+    int n = i % pageSize;
+    if (n < page.count())
+        return page.at(n);
+    return Row<Table>();
 }
 
 
@@ -49,20 +49,46 @@ public:
     int columnCount(const QModelIndex &parent) const;
     QVariant data(const QModelIndex &index, int role) const;
 
+    bool canFetchMore(const QModelIndex &parent) const;
+    void fetchMore(const QModelIndex &parent);
+
+    int pageSize() const;
+    void setPageSize(int pageSize);
+    int cachedPages() const;
+    void setCachedPages(int cachedPages);
+    int totalCount() const;
+
+    void sort(int column, Qt::SortOrder order = Qt::AscendingOrder);
+    ConditionalPhrase filter() const;
+    void setFilter(const ConditionalPhrase &filter);
+
     template<class T>
     void setTable(RowList<T> rows);
 
     void setRows(RowList<Table> rows);
+    void refresh();
     void append(Row<Table> table);
 //    void append(Table *table);
     QVariant headerData(int section, Qt::Orientation orientation, int role) const;
     Row<Nut::Table> at(const int &i) const;
 
+    bool isValueCacheEnabled() const;
+    void setValueCacheEnabled(bool enabled);
+
     void setRenderer(const std::function<QVariant (int, QVariant)> &renderer);
 
 private:
     QExplicitlySharedDataPointer<SqlModelPrivate> d;
 
+    void updateRows(QVariantList keys, const RowList<Table> &rows);
+    void setBinder(const SqlModelPrivate::BindFunction &bind);
+    void setSource(const SqlModelPrivate::FetchFunction &fetch,
+                   const SqlModelPrivate::CountFunction &count,
+                   const QStringList &keyFields);
+
+    template<class T>
+    friend class Query;
+
 signals:
     void beforeShowText(int col, QVariant &value);
 };
@@ -3,7 +3,14 @@
 
 #include <QSharedPointer>
 #include <QString>
+#include <QtCore/QByteArray>
+#include <QtCore/QMap>
+#include <QtCore/QStringList>
+#include <QtCore/QVector>
+#include <QtCore/QVariant>
+#include <functional>
 #include "defines.h"
+#include "phrase.h"
 
 NUT_BEGIN_NAMESPACE
 
@@ -14,10 +21,54 @@ class SqlModelPrivate : public QSharedData {
 public:
     explicit SqlModelPrivate(SqlModel *parent);
 
+    typedef std::function<RowList<Table>(const QVariantList &after,
+                                          int skip, int take)> FetchFunction;
+    typedef std::function<int()> CountFunction;
+    typedef std::function<void(int column, Qt::SortOrder order,
+                               const ConditionalPhrase &filter)> BindFunction;
+
     QString tableName;
 
     RowList<Table> rows;
     TableModel *model;
+
+    // property index and name of each column
+    QVector<int> columns;
+    QVector<QByteArray> columnNames;
+    bool cacheValues;
+    QVector<QVector<QVariant>> values;
+
+    // paged mode, used when model is filled by Query::toModel
+    BindFunction bind;
+    int sortColumn;
+    Qt::SortOrder sortOrder;
+    ConditionalPhrase filter;
+
+    FetchFunction fetch;
+    CountFunction count;
+    QStringList keyFields;
+    int pageSize;
+    int cachedPages;
+    int totalCount;
+    int fetchedCount;
+    QMap<int, RowList<Table>> pages;
+    QVector<QVariantList> pageKeys;
+    QVariantList rowKeys;
+
+    bool isPaged() const;
+    void resetPages();
+    RowList<Table> loadPage(int page);
+    Row<Table> row(int i);
+    QVariant value(int i, int column);
+
+    void clearValues();
+    void invalidateValues(int first, int last);
+    void insertValues(int first, int count);
+    void removeValues(int first, int last);
+    void moveValue(int from, int to);
+    bool isChanged(const Row<Table> &oldRow, const Row<Table> &newRow) const;
+
+    static bool isKeysUnique(const RowList<Table> &rows);
 };
 
 NUT_END_NAMESPACE
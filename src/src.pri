@@ -1,5 +1,12 @@
 DEFINES += NUT_SHARED_POINTER
 
+# Incremental blob I/O of sqlite for BlobStream, QtSql must be built with
+# -system-sqlite so handle of its driver belongs to the linked library
+nut_sqlite_blob {
+    DEFINES += NUT_SQLITE_BLOB
+    LIBS += -lsqlite3
+}
+
 HEADERS += \
     $$PWD/generators/sqlgeneratorbase_p.h \
     $$PWD/generators/postgresqlgenerator.h \
@@ -12,6 +19,7 @@ HEADERS += \
     $$PWD/defines_p.h \
     $$PWD/defines.h \
     $$PWD/query.h \
+    $$PWD/compiledquery.h \
     $$PWD/databasemodel.h \
     $$PWD/changelogtable.h \
     $$PWD/tablesetbase_p.h \
@@ -24,6 +32,7 @@ HEADERS += \
     $$PWD/serializableobject.h \
     $$PWD/sqlmodel.h \
     $$PWD/sqlmodel_p.h \
+    $$PWD/blobstream.h \
     $$PWD/phrase.h \
     $$PWD/phrases/abstractfieldphrase.h \
     $$PWD/phrases/assignmentphrase.h \
@@ -34,7 +43,11 @@ HEADERS += \
     $$PWD/phrases/phrasedatalist.h \
     $$PWD/phrases/phraselist.h \
     $$PWD/phrases/datephrase.h \
-    $$PWD/table_p.h
+    $$PWD/phrases/parameter.h \
+    $$PWD/phrases/aggregatephrase.h \
+    $$PWD/tuple.h \
+    $$PWD/table_p.h \
+    $$PWD/rowpool_p.h
 
 SOURCES += \
     $$PWD/generators/sqlgeneratorbase.cpp \
@@ -54,6 +67,7 @@ SOURCES += \
     $$PWD/database.cpp \
     $$PWD/serializableobject.cpp \
     $$PWD/sqlmodel.cpp \
+    $$PWD/blobstream.cpp \
     $$PWD/phrase.cpp \
     $$PWD/phrases/abstractfieldphrase.cpp \
     $$PWD/phrases/assignmentphrase.cpp \
@@ -63,7 +77,9 @@ SOURCES += \
     $$PWD/phrases/phrasedata.cpp \
     $$PWD/phrases/phrasedatalist.cpp \
     $$PWD/phrases/phraselist.cpp \
-    $$PWD/phrases/datephrase.cpp
+    $$PWD/phrases/datephrase.cpp \
+    $$PWD/tuple.cpp \
+    $$PWD/rowpool.cpp
 
 
 include($$PWD/../3rdparty/serializer/src/src.pri)
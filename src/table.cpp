@@ -18,9 +18,12 @@
 **
 **************************************************************************/
 
+#include <QHash>
 #include <QMetaMethod>
+#include <QMetaProperty>
 #include <QVariant>
 #include <QSqlQuery>
+#include <QSqlRecord>
 
 #include "table.h"
 #include "table_p.h"
@@ -28,6 +31,11 @@
 #include "databasemodel.h"
 #include "generators/sqlgeneratorbase_p.h"
 #include "tablesetbase_p.h"
+#include "rowpool_p.h"
+
+#ifndef __NUT_DEFERRED_BATCH_SIZE
+#   define __NUT_DEFERRED_BATCH_SIZE 500
+#endif
 
 NUT_BEGIN_NAMESPACE
 
@@ -44,7 +52,7 @@ NUT_BEGIN_NAMESPACE
  */
 
 Table::Table(QObject *parent) : QObject(parent),
-    d(new TablePrivate)
+    d(new TablePrivate), _hasNotLoaded(false)
 { }
 
 Table::~Table()
@@ -95,8 +103,29 @@ void Table::propertyChanged(const QString &propName)
 //        if(f->isPrimaryKey && propName == f->name && f->isAutoIncrement)
 //            return;
 
-    d.detach();
-    d->changedProperties.insert(propName);
+    propertyChanged(metaObject()->indexOfProperty(propName.toLatin1().data()));
+}
+
+/*
+ * Changed fields are kept in a bit array indexed by property index of
+ * meta object, generated setters pass the index that is resolved once
+ */
+void Table::propertyChanged(int propertyIndex)
+{
+    if (propertyIndex < 0)
+        return;
+
+    // Assigned value replaces the one that is not loaded yet
+    if (_hasNotLoaded)
+        setPropertyLoaded(propertyIndex);
+
+    if (!d->trackChanges)
+        return;
+
+    if (d->changedProperties.size() <= propertyIndex)
+        d->changedProperties.resize(metaObject()->propertyCount());
+    d->changedProperties.setBit(propertyIndex);
+
     if (d->status == FeatchedFromDB)
         d->status = Modified;
 
@@ -104,6 +133,18 @@ void Table::propertyChanged(const QString &propName)
         d->status = Added;
 }
 
+bool Table::trackChanges() const
+{
+    return d->trackChanges;
+}
+
+void Table::setTrackChanges(bool trackChanges)
+{
+    d->trackChanges = trackChanges;
+    if (!trackChanges)
+        d->changedProperties.clear();
+}
+
 void Table::setModel(TableModel *model)
 {
     //Q_D(Table);
@@ -113,13 +154,133 @@ void Table::setModel(TableModel *model)
 void Table::clear()
 {
     //Q_D(Table);
+    if (!d->originalValues.isEmpty())
+        for (int i = 0; i < d->changedProperties.size(); ++i)
+            if (d->changedProperties.testBit(i))
+                d->originalValues[i] = metaObject()->property(i).read(this);
+
     d->changedProperties.clear();
 }
 
+/*
+ * Keeps current values of fields, when exists only fields that their
+ * values differ from these are treated as changed
+ */
+void Table::saveOriginalValues(TableModel *model)
+{
+    const QMetaObject *mo = metaObject();
+    d->originalValues.fill(QVariant(), mo->propertyCount());
+    foreach (FieldModel *f, model->fields()) {
+        int index = mo->indexOfProperty(f->name.toLatin1().data());
+        if (index >= 0 && isPropertyLoaded(index))
+            d->originalValues[index] = mo->property(index).read(this);
+    }
+}
+
 QSet<QString> Table::changedProperties() const
 {
     //Q_D(const Table);
-    return d->changedProperties;
+    QSet<QString> ret;
+    for (int i = 0; i < d->changedProperties.size(); ++i)
+        if (isPropertyChanged(i))
+            ret.insert(metaObject()->property(i).name());
+    return ret;
+}
+
+QBitArray Table::changedPropertyBits() const
+{
+    if (d->originalValues.isEmpty())
+        return d->changedProperties;
+
+    QBitArray ret = d->changedProperties;
+    for (int i = 0; i < ret.size(); ++i)
+        if (!isPropertyChanged(i))
+            ret.clearBit(i);
+    return ret;
+}
+
+bool Table::isPropertyChanged(int propertyIndex) const
+{
+    if (propertyIndex < 0
+            || propertyIndex >= d->changedProperties.size()
+            || !d->changedProperties.testBit(propertyIndex))
+        return false;
+
+    if (propertyIndex >= d->originalValues.size())
+        return true;
+
+    return metaObject()->property(propertyIndex).read(this)
+            != d->originalValues.at(propertyIndex);
+}
+
+bool Table::isPropertyLoaded(int propertyIndex) const
+{
+    return !_hasNotLoaded
+            || propertyIndex < 0
+            || propertyIndex >= d->notLoaded.size()
+            || !d->notLoaded.testBit(propertyIndex);
+}
+
+/*
+ * Called by getters of fields when row has values that are not loaded
+ */
+void Table::loadProperty(int propertyIndex) const
+{
+    if (isPropertyLoaded(propertyIndex))
+        return;
+
+    // Loader may be released by the rows it fills
+    QSharedPointer<DeferredLoader> loader = d->loader;
+    if (loader)
+        loader->load(propertyIndex);
+
+    // Value of a row that is not found remains default
+    const_cast<Table*>(this)->setPropertyLoaded(propertyIndex);
+}
+
+void Table::setNotLoaded(const QBitArray &properties, Database *db,
+                         TableModel *model, Table *batch)
+{
+    d->notLoaded = properties;
+    _hasNotLoaded = properties.count(true) > 0;
+    if (!_hasNotLoaded) {
+        d->loader.clear();
+        return;
+    }
+
+    if (batch && batch->d->loader && batch->d->loader->model == model)
+        d->loader = batch->d->loader;
+    else
+        d->loader = QSharedPointer<DeferredLoader>(
+                    new DeferredLoader(db, model));
+    d->loader->rows.append(this);
+}
+
+void Table::setPropertyLoaded(int propertyIndex)
+{
+    if (isPropertyLoaded(propertyIndex))
+        return;
+
+    d->notLoaded.clearBit(propertyIndex);
+    if (!d->notLoaded.count(true)) {
+        _hasNotLoaded = false;
+        d->loader.clear();
+    }
+}
+
+/*
+ * Writes loaded value without marking property as changed
+ */
+void Table::setLoadedValue(int propertyIndex, const QVariant &value)
+{
+    bool track = d->trackChanges;
+    d->trackChanges = false;
+    metaObject()->property(propertyIndex).write(this, value);
+    d->trackChanges = track;
+
+    setPropertyLoaded(propertyIndex);
+    if (propertyIndex < d->originalValues.size())
+        d->originalValues[propertyIndex] = value;
 }
 
 bool Table::setParentTable(Table *master, TableModel *masterModel, TableModel *model)
@@ -136,9 +297,10 @@ bool Table::setParentTable(Table *master, TableModel *masterModel, TableModel *m
     foreach (RelationModel *r, model->foreignKeys())
         if(r->masterClassName == masterClassName)
         {
-            setProperty(QString(r->localColumn).toLatin1().data(),
+            QByteArray localColumn = r->localColumn.toLatin1();
+            setProperty(localColumn.data(),
                         master->property(masterModel->primaryKey().toUtf8().data()));
-            d->changedProperties.insert(r->localColumn);
+            propertyChanged(metaObject()->indexOfProperty(localColumn.data()));
             return true;
         }
 
@@ -173,17 +335,60 @@ int Table::save(Database *db)
 {
     //Q_D(Table);
 
-    QSqlQuery q = db->exec(db->sqlGenertor()->saveRecord(this, db->tableName(metaObject()->className())));
+    QVariantMap binds;
+    QString sql = db->sqlGenertor()->saveRecord(this, db->tableName(metaObject()->className()),
+                                                &binds);
+
+    // Nothing really changed
+    if (sql.isEmpty()) {
+        setStatus(FeatchedFromDB);
+        clear();
+        return 0;
+    }
+
+    QSqlQuery q = db->exec(sql, binds);
 
     auto model = db->model().tableByClassName(metaObject()->className());
-    if(status() == Added && model->isPrimaryKeyAutoIncrement())
+    int rowsAffected = q.numRowsAffected();
+
+    // Generators that support RETURNING (or OUTPUT INSERTED) send back
+    // the stored row, so generated keys, defaults and trigger computed
+    // values are read without another query
+    if (status() != Deleted && q.isSelect() && q.next()) {
+        loadValues(model, db->sqlGenertor(), q.record());
+        rowsAffected = 1;
+    } else if(status() == Added && model->isPrimaryKeyAutoIncrement()) {
         setProperty(model->primaryKey().toLatin1().data(), q.lastInsertId());
+    }
 
     foreach(TableSetBase *ts, d->childTableSets)
         ts->save(db);
     setStatus(FeatchedFromDB);
+    clear();
+
+    return rowsAffected;
+}
 
-    return q.numRowsAffected();
+void Table::loadValues(TableModel *model, SqlGeneratorBase *generator,
+                       const QSqlRecord &record)
+{
+    foreach (FieldModel *f, model->fields()) {
+        // Deferred fields are not returned
+        if (!record.contains(f->name))
+            continue;
+
+        QVariant v = generator->unescapeValue(f->type, record.value(f->name));
+        if (f->propertyIndex > 0) {
+            QMetaProperty p = metaObject()->property(f->propertyIndex);
+            if (!isPropertyLoaded(f->propertyIndex) || p.read(this) != v)
+                p.write(this, v);
+            continue;
+        }
+
+        QByteArray name = f->name.toLatin1();
+        if (property(name.data()) != v)
+            setProperty(name.data(), v);
+    }
 }
 
 Table::Status Table::status() const
@@ -200,12 +405,91 @@ void Table::setStatus(const Status &status)
 
 
 
+/*
+ * Rows and their private data are allocated from RowPool, memory of
+ * released rows is reused by next queries
+ */
+void *Table::operator new(std::size_t size)
+{
+    return RowPool::allocate(size);
+}
+
+void Table::operator delete(void *p, std::size_t size)
+{
+    RowPool::release(p, size);
+}
+
+void *TablePrivate::operator new(std::size_t size)
+{
+    return RowPool::allocate(size);
+}
+
+void TablePrivate::operator delete(void *p, std::size_t size)
+{
+    RowPool::release(p, size);
+}
+
 TablePrivate::TablePrivate() : QSharedData(),
-    model(nullptr), status(Table::NewCreated), parentTableSet(nullptr)
+    model(nullptr), status(Table::NewCreated), trackChanges(true),
+    parentTableSet(nullptr)
 {
 
 }
 
+DeferredLoader::DeferredLoader(Database *database, TableModel *model)
+    : database(database), model(model)
+{ }
+
+void DeferredLoader::load(int propertyIndex)
+{
+    FieldModel *field = nullptr;
+    foreach (FieldModel *f, model->fields())
+        if (f->propertyIndex == propertyIndex)
+            field = f;
+
+    if (!field || !database)
+        return;
+
+    FieldModel *keyField = model->field(model->primaryKey());
+    SqlGeneratorBase *generator = database->sqlGenertor();
+
+    // Rows are matched by text of their keys
+    QMultiHash<QString, Table*> pending;
+    QVariantList keys;
+    QList<QPointer<Table>>::iterator i = rows.begin();
+    while (i != rows.end()) {
+        Table *row = i->data();
+        if (!row) {
+            i = rows.erase(i);
+            continue;
+        }
+        ++i;
+
+        if (row->isPropertyLoaded(propertyIndex))
+            continue;
+
+        QVariant key = row->primaryValue();
+        if (!pending.contains(key.toString()))
+            keys.append(key);
+        pending.insert(key.toString(), row);
+    }
+
+    for (int n = 0; n < keys.count(); n += __NUT_DEFERRED_BATCH_SIZE) {
+        QSqlQuery q = database->exec(generator->selectByKeys(
+                                         model->name(), model->primaryKey(),
+                                         QStringList() << field->name,
+                                         keys.mid(n, __NUT_DEFERRED_BATCH_SIZE)));
+        while (q.next()) {
+            QVariant key = keyField
+                    ? generator->unescapeValue(keyField->type, q.value(0))
+                    : q.value(0);
+            QVariant value = generator->unescapeValue(field->type, q.value(1));
+            foreach (Table *row, pending.values(key.toString()))
+                row->setLoadedValue(propertyIndex, value);
+        }
+    }
+}
+
 void TablePrivate::refreshModel()
 {
 //    Q_Q(Table);
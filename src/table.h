@@ -24,14 +24,20 @@
 #include <QtCore/QObject>
 #include <QtCore/qglobal.h>
 #include <QtCore/QSet>
+#include <QtCore/QBitArray>
+
+#include <cstddef>
 
 #include "tablemodel.h"
 #include "defines.h"
 #include "phrase.h"
 
+class QSqlRecord;
+
 NUT_BEGIN_NAMESPACE
 
 class Database;
+class SqlGeneratorBase;
 class TableSetBase;
 class TableModel;
 class TablePrivate;
@@ -60,12 +66,19 @@ public:
     Status status() const;
     void setStatus(const Status &status);
 
+    static void *operator new(std::size_t size);
+    static void operator delete(void *p, std::size_t size);
+
     TableSetBase *parentTableSet() const;
     void setParentTableSet(TableSetBase *parentTableSet);
 
     TableSetBase *childTableSet(const QString &name) const;
 
     QSet<QString> changedProperties() const;
+    QBitArray changedPropertyBits() const;
+    bool isPropertyChanged(int propertyIndex) const;
+    bool isPropertyLoaded(int propertyIndex) const;
+    bool trackChanges() const;
 
     bool setParentTable(Table *master, TableModel *masterModel, TableModel *model);
 signals:
@@ -74,8 +87,14 @@ public slots:
 
 protected:
     void propertyChanged(const QString &propName);
+    void propertyChanged(int propertyIndex);
+
+    inline bool hasNotLoadedProperties() const { return _hasNotLoaded; }
+    void loadProperty(int propertyIndex) const;
 
 private:
+    bool _hasNotLoaded;
+
     void setModel(TableModel *model);
 //    TableModel *myModel;
 //    Status _status;
@@ -85,7 +104,15 @@ private:
 
 //    QSet<TableSetBase*> childTableSets;
     void clear();
+    void setTrackChanges(bool trackChanges);
+    void saveOriginalValues(TableModel *model);
     void add(TableSetBase *);
+    void loadValues(TableModel *model, SqlGeneratorBase *generator,
+                    const QSqlRecord &record);
+    void setNotLoaded(const QBitArray &properties, Database *db,
+                      TableModel *model, Table *batch);
+    void setPropertyLoaded(int propertyIndex);
+    void setLoadedValue(int propertyIndex, const QVariant &value);
 
     template<class T>
     friend class Query;
@@ -93,6 +120,8 @@ private:
     template<class T>
     friend class TableSet;
     friend class TableSetBase;
+    friend class DatabasePrivate;
+    friend class DeferredLoader;
 };
 
 NUT_END_NAMESPACE
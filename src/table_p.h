@@ -4,13 +4,35 @@
 #include "defines.h"
 
 #include <QtCore/QSet>
+#include <QtCore/QBitArray>
+#include <QtCore/QVector>
+#include <QtCore/QVariant>
+#include <QtCore/QPointer>
+#include <QtCore/QSharedPointer>
 #include <QSharedData>
 
 NUT_BEGIN_NAMESPACE
 
+class Database;
 class TableModel;
 class Table;
 class TableSetBase;
+
+/*
+ * Rows fetched by a query share a loader, deferred values are read for all
+ * of them when first one is accessed
+ */
+class DeferredLoader {
+public:
+    DeferredLoader(Database *database, TableModel *model);
+
+    QPointer<Database> database;
+    TableModel *model;
+    QList<QPointer<Table>> rows;
+
+    void load(int propertyIndex);
+};
+
 class TablePrivate : public QSharedData {
     Table *q_ptr;
     Q_DECLARE_PUBLIC(Table)
@@ -18,10 +40,16 @@ class TablePrivate : public QSharedData {
 public:
     TablePrivate();
 
+    static void *operator new(std::size_t size);
+    static void operator delete(void *p, std::size_t size);
 
     TableModel *model;
     int status;
-    QSet<QString> changedProperties;
+    bool trackChanges;
+    QBitArray changedProperties;
+    QVector<QVariant> originalValues;
+    QBitArray notLoaded;
+    QSharedPointer<DeferredLoader> loader;
     TableSetBase *parentTableSet;
     QSet<TableSetBase*> childTableSets;
 
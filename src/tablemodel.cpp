@@ -21,6 +21,8 @@
 #include <QtCore/QMetaObject>
 #include <QtCore/QMetaProperty>
 #include <QtCore/QDebug>
+#include <QtCore/QHash>
+#include <QtCore/QVarLengthArray>
 
 #include <QJsonArray>
 #include <QJsonObject>
@@ -87,6 +89,11 @@ QList<RelationModel *> TableModel::foreignKeys() const
     return _foreignKeys;
 }
 
+QList<IndexModel *> TableModel::indexes() const
+{
+    return _indexes;
+}
+
 QStringList TableModel::fieldsNames() const
 {
     QStringList ret;
@@ -95,7 +102,8 @@ QStringList TableModel::fieldsNames() const
     return ret;
 }
 
-bool TableModel::operator ==(const TableModel &t) const{
+bool TableModel::isFieldsEqual(const TableModel &t) const
+{
     if(_name != t.name())
         return false;
 
@@ -114,6 +122,31 @@ bool TableModel::operator ==(const TableModel &t) const{
     return true;
 }
 
+bool TableModel::operator ==(const TableModel &t) const{
+    if (!isFieldsEqual(t))
+        return false;
+
+    if (_indexes.count() != t.indexes().count())
+        return false;
+
+    foreach (IndexModel *i, _indexes) {
+        IndexModel *ti = t.index(i->name);
+        if (!ti || *i != *ti)
+            return false;
+    }
+
+    if (_foreignKeys.count() != t.foreignKeys().count())
+        return false;
+
+    foreach (RelationModel *r, _foreignKeys) {
+        RelationModel *tr = t.foreignKeyByField(r->localColumn);
+        if (!tr || *r != *tr)
+            return false;
+    }
+
+    return true;
+}
+
 bool TableModel::operator !=(const TableModel &t) const
 {
     return !(*this == t);
@@ -136,86 +169,155 @@ TableModel::TableModel(int typeId, const QString &tableName)
 //        _className = _className.replace(QT_STRINGIFY(NUT_NAMESPACE) "::", "");
 //#endif
 
-    // get fields names
-    for(int j = 0; j < tableMetaObject->classInfoCount(); j++){
-        QString type;
-        QString name;
-        QString value;
+    // Class infos are split once, parts point into meta object data
+    struct ClassInfo {
+        QLatin1String type;
+        QLatin1String name;
+        QLatin1String value;
+    };
+    QVarLengthArray<ClassInfo, 64> infos;
+    QHash<QString, FieldModel*> fieldsByName;
 
-        if (!nutClassInfoString(tableMetaObject->classInfo(j),
-                            type, name, value)) {
+    for(int j = 0; j < tableMetaObject->classInfoCount(); j++){
+        ClassInfo info;
+        if (!nutClassInfoParts(tableMetaObject->classInfo(j),
+                               info.type, info.name, info.value))
             continue;
-        }
 
-        if(type == __nut_FIELD){
+        if(info.type == QLatin1String(__nut_FIELD)){
             auto *f = new FieldModel;
-            f->name = f->displayName = name;
+            f->name = f->displayName = nutClassInfoText(info.name);
             _fields.append(f);
+            fieldsByName.insert(f->name, f);
+            continue;
         }
+        infos.append(info);
     }
+
     // Browse all fields
     for(int j = 1; j < tableMetaObject->propertyCount(); j++){
         QMetaProperty fieldProperty = tableMetaObject->property(j);
 
-        FieldModel *fieldObj = field(fieldProperty.name());
-        foreach (FieldModel *f, _fields)
-            if(f->name == fieldProperty.name())
-                f = fieldObj;
+        FieldModel *fieldObj = fieldsByName.value(QString::fromUtf8(fieldProperty.name()));
         if(!fieldObj)
             continue;
         fieldObj->type = static_cast<QMetaType::Type>(fieldProperty.type());
         fieldObj->typeName = QString(fieldProperty.typeName());
+        fieldObj->propertyIndex = j;
     }
 
     // Browse class infos
-    for(int j = 0; j < tableMetaObject->classInfoCount(); j++){
-        QString type;
-        QString name;
-        QString value;
-
-        if (!nutClassInfoString(tableMetaObject->classInfo(j),
-                            type, name, value)) {
-            continue;
-        }
-
-        if(type == __nut_FOREIGN_KEY){
+    QHash<QString, QString> indexWheres;
+    QHash<QString, QString> constraints;
+    foreach (const ClassInfo &info, infos) {
+        const QLatin1String &type = info.type;
+        QString name = nutClassInfoText(info.name);
+        QString value = nutClassInfoText(info.value);
+
+        if(type == QLatin1String(__nut_FOREIGN_KEY)){
             auto *fk = new RelationModel;
             fk->slaveTable = this;
             fk->localColumn = name + "Id";
             fk->localProperty = name;
-            fk->foreignColumn = value;
             fk->masterClassName = value;
             _foreignKeys.append(fk);
+            continue;
         }
 
-        if(type == __nut_FIELD){
+        if (type == QLatin1String(__nut_FOREIGN_KEY_CONSTRAINT)) {
+            constraints.insert(name, value);
+            continue;
+        }
 
+        if (type == QLatin1String(__nut_INDEX)
+                || type == QLatin1String(__nut_UNIQUE_INDEX)) {
+            auto *index = new IndexModel(name, value);
+            index->isUnique = (type == QLatin1String(__nut_UNIQUE_INDEX));
+            _indexes.append(index);
+            continue;
         }
 
+        if (type == QLatin1String(__nut_INDEX_WHERE)) {
+            indexWheres.insert(name, value);
+            continue;
+        }
 
-        FieldModel *f = field(name);
+        FieldModel *f = fieldsByName.value(name);
         if (!f)
             continue;
 
-        if (type == __nut_LEN)
+        if (type == QLatin1String(__nut_LEN))
             f->length = value.toInt();
-        else if (type == __nut_NOT_NULL)
+        else if (type == QLatin1String(__nut_NOT_NULL))
             f->notNull = true;
-        else if (type == __nut_DEFAULT_VALUE)
+        else if (type == QLatin1String(__nut_DEFAULT_VALUE))
             f->defaultValue = value;
-        else if (type == __nut_PRIMARY_KEY)
+        else if (type == QLatin1String(__nut_PRIMARY_KEY))
             f->isPrimaryKey = true;
-        else if (type == __nut_AUTO_INCREMENT)
+        else if (type == QLatin1String(__nut_AUTO_INCREMENT))
             f->isAutoIncrement = true;
-        else if (type == __nut_UNIQUE)
+        else if (type == QLatin1String(__nut_UNIQUE))
             f->isUnique = true;
-        else if (type == __nut_DISPLAY)
-            f->displayName = value.mid(1, value.length() - 2);
-        else if (type == __nut_PRIMARY_KEY_AI) {
+        else if (type == QLatin1String(__nut_RENAMED_FROM))
+            f->renamedFrom = value;
+        else if (type == QLatin1String(__nut_DEFERRED))
+            f->isDeferred = true;
+        else if (type == QLatin1String(__nut_DISPLAY))
+            f->displayName = value.mid(1, value.size() - 2);
+        else if (type == QLatin1String(__nut_PRIMARY_KEY_AI)) {
             f->isPrimaryKey = true;
             f->isAutoIncrement = true;
         }
     }
+
+    foreach (IndexModel *index, _indexes) {
+        index->where = indexWheres.value(index->name);
+        foreach (QString f, index->fields)
+            if (!field(f))
+                qWarning("Index %s of %s refers to unknown field %s",
+                         qPrintable(index->name), qPrintable(_className),
+                         qPrintable(f));
+    }
+
+    // Deferred values are loaded by primary key, so key itself is never
+    // deferred
+    foreach (FieldModel *f, _fields)
+        if (f->isDeferred && f->isPrimaryKey) {
+            qWarning("Primary key %s of %s can not be deferred",
+                     qPrintable(f->name), qPrintable(_className));
+            f->isDeferred = false;
+        }
+
+    foreach (RelationModel *fk, _foreignKeys) {
+        if (constraints.contains(fk->localProperty)) {
+            fk->isConstraint = true;
+            fk->onDelete = constraints.value(fk->localProperty)
+                    .replace('_', ' ').toUpper();
+        }
+
+        // Every foreign key is indexed, unless an index starts with it
+        bool indexed = false;
+        foreach (IndexModel *index, _indexes)
+            if (!index->fields.isEmpty()
+                    && index->fields.first() == fk->localColumn)
+                indexed = true;
+
+        if (!indexed)
+            _indexes.append(new IndexModel(QString("ix_%1_%2")
+                                           .arg(_name, fk->localColumn),
+                                           fk->localColumn));
+    }
+
+    // Unique fields are kept by an unique index
+    foreach (FieldModel *f, _fields) {
+        if (!f->isUnique || f->isPrimaryKey)
+            continue;
+
+        auto *index = new IndexModel(QString("uq_%1_%2").arg(_name, f->name),
+                                     f->name);
+        index->isUnique = true;
+        _indexes.append(index);
+    }
 }
 
 /*
@@ -240,6 +342,7 @@ TableModel::TableModel(const QJsonObject &json, const QString &tableName) : _typ
 
     QJsonObject fields = json.value(__FIELDS).toObject();
     QJsonObject relations = json.value(__FOREIGN_KEYS).toObject();
+    QJsonObject indexes = json.value(__INDEXES).toObject();
     foreach (QString key, fields.keys()) {
         QJsonObject fieldObject = fields.value(key).toObject();
         //TODO: use FieldModel(QJsonObject) ctor
@@ -259,16 +362,30 @@ TableModel::TableModel(const QJsonObject &json, const QString &tableName) : _typ
         _fields.append(f);
     }
 
+    FieldModel *pk = field(json.value(__nut_PRIMARY_KEY).toString());
+    if (pk)
+        pk->isPrimaryKey = true;
+
+    FieldModel *ai = field(json.value(__nut_AUTO_INCREMENT).toString());
+    if (ai)
+        ai->isAutoIncrement = true;
+
     foreach (QString key, relations.keys()) {
-        QJsonObject relObject = fields.value(key).toObject();
-        _foreignKeys.append(new RelationModel(relObject));
+        QJsonObject relObject = relations.value(key).toObject();
+        auto *fk = new RelationModel(relObject);
+        fk->slaveTable = this;
+        _foreignKeys.append(fk);
     }
+
+    foreach (QString key, indexes.keys())
+        _indexes.append(new IndexModel(indexes.value(key).toObject(), key));
 }
 
 TableModel::~TableModel()
 {
     qDeleteAll(_fields);
     qDeleteAll(_foreignKeys);
+    qDeleteAll(_indexes);
 }
 
 QJsonObject TableModel::toJson() const
@@ -276,6 +393,7 @@ QJsonObject TableModel::toJson() const
     QJsonObject obj;
     QJsonObject fieldsObj;
     QJsonObject foreignKeysObj;
+    QJsonObject indexesObj;
 
     foreach (FieldModel *f, _fields) {
         QJsonObject fieldObj;
@@ -301,9 +419,13 @@ QJsonObject TableModel::toJson() const
     }
     foreach (RelationModel *rel, _foreignKeys)
         foreignKeysObj.insert(rel->localColumn, rel->toJson());
+    foreach (IndexModel *index, _indexes)
+        indexesObj.insert(index->name, index->toJson());
 
     obj.insert(__FIELDS, fieldsObj);
     obj.insert(__FOREIGN_KEYS, foreignKeysObj);
+    if (!indexesObj.isEmpty())
+        obj.insert(__INDEXES, indexesObj);
 
     return obj;
 }
@@ -326,6 +448,15 @@ RelationModel *TableModel::foreignKeyByField(const QString &fieldName) const
     return nullptr;
 }
 
+IndexModel *TableModel::index(const QString &name) const
+{
+    foreach (IndexModel *index, _indexes)
+        if(index->name == name)
+            return index;
+
+    return nullptr;
+}
+
 QString TableModel::toString() const
 {
     QStringList sl;
@@ -384,6 +515,8 @@ RelationModel::RelationModel(const QJsonObject &obj)
     localProperty = obj.value("localProperty").toString();
     masterClassName = obj.value("masterClassName").toString();
     foreignColumn = obj.value("foreignColumn").toString();
+    isConstraint = obj.value("constraint").toBool();
+    onDelete = obj.value("onDelete").toString();
     slaveTable = masterTable = nullptr;
 }
 
@@ -394,6 +527,10 @@ QJsonObject RelationModel::toJson() const
     o.insert("localProperty", localProperty);
     o.insert("masterClassName", masterClassName);
     o.insert("foreignColumn", foreignColumn);
+    if (isConstraint) {
+        o.insert("constraint", isConstraint);
+        o.insert("onDelete", onDelete);
+    }
     return o;
 }
 
@@ -402,7 +539,9 @@ bool operator ==(const RelationModel &l, const RelationModel &r)
     return r.foreignColumn == l.foreignColumn
             && r.localColumn == l.localColumn
             && r.localProperty == l.localProperty
-            && r.masterClassName == l.masterClassName;
+            && r.masterClassName == l.masterClassName
+            && r.isConstraint == l.isConstraint
+            && r.onDelete == l.onDelete;
 }
 
 bool operator !=(const RelationModel &l, const RelationModel &r)
@@ -410,4 +549,71 @@ bool operator !=(const RelationModel &l, const RelationModel &r)
     return !(l == r);
 }
 
+IndexModel::IndexModel(const QString &name, const QString &fieldsText)
+    : name(name), where(QString())
+{
+    setFieldsText(fieldsText);
+}
+
+IndexModel::IndexModel(const QJsonObject &json, const QString &name)
+    : name(name)
+{
+    setFieldsText(json.value(__FIELDS).toString());
+    isUnique = json.value(__nut_UNIQUE).toBool();
+    where = json.value(__nut_WHERE).toString();
+}
+
+/*
+ * Fields are kept in text as "field1, field2 desc, ...", the same form
+ * that NUT_INDEX macros and change log json use
+ */
+QString IndexModel::fieldsText() const
+{
+    QStringList ret;
+    for (int i = 0; i < fields.count(); ++i)
+        ret.append(descending.at(i) ? fields.at(i) + " desc" : fields.at(i));
+    return ret.join(", ");
+}
+
+void IndexModel::setFieldsText(const QString &text)
+{
+    fields.clear();
+    descending.clear();
+
+    foreach (QString part, text.split(',', QString::SkipEmptyParts)) {
+        QStringList words = part.simplified().split(' ');
+        if (words.first().isEmpty())
+            continue;
+
+        fields.append(words.first());
+        descending.append(words.count() > 1
+                          && words.at(1).toLower() == "desc");
+    }
+}
+
+bool IndexModel::operator ==(const IndexModel &i) const
+{
+    return name == i.name
+            && fields == i.fields
+            && descending == i.descending
+            && isUnique == i.isUnique
+            && where == i.where;
+}
+
+bool IndexModel::operator !=(const IndexModel &i) const
+{
+    return !(*this == i);
+}
+
+QJsonObject IndexModel::toJson() const
+{
+    QJsonObject o;
+    o.insert(__FIELDS, fieldsText());
+    if (isUnique)
+        o.insert(__nut_UNIQUE, isUnique);
+    if (!where.isEmpty())
+        o.insert(__nut_WHERE, where);
+    return o;
+}
+
 NUT_END_NAMESPACE
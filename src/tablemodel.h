@@ -47,7 +47,10 @@ struct FieldModel{
     bool isPrimaryKey{false};
     bool isAutoIncrement{false};
     bool isUnique{false};
+    bool isDeferred{false};
     QString displayName;
+    QString renamedFrom;
+    int propertyIndex{-1};
 
     bool operator ==(const FieldModel &f) const{
 
@@ -69,7 +72,8 @@ struct FieldModel{
 
 struct RelationModel{
     RelationModel() : localColumn(QString()), localProperty(QString()),
-        slaveTable(nullptr), foreignColumn(QString()), masterClassName(QString())
+        slaveTable(nullptr), foreignColumn(QString()), masterClassName(QString()),
+        onDelete(QString())
     {}
     explicit RelationModel(const QJsonObject &obj);
 
@@ -83,12 +87,37 @@ struct RelationModel{
 
     QString masterClassName;
 
+    //constraint
+    bool isConstraint{false};
+    QString onDelete;
+
     QJsonObject toJson() const;
 };
 
 bool operator ==(const RelationModel &l, const RelationModel &r);
 bool operator !=(const RelationModel &l, const RelationModel &r);
 
+struct IndexModel{
+    IndexModel() : name(QString()), where(QString())
+    {}
+    explicit IndexModel(const QString &name, const QString &fieldsText);
+    explicit IndexModel(const QJsonObject &json, const QString &name);
+
+    QString name;
+    QStringList fields;
+    QList<bool> descending;
+    bool isUnique{false};
+    QString where;
+
+    QString fieldsText() const;
+    void setFieldsText(const QString &text);
+
+    bool operator ==(const IndexModel &i) const;
+    bool operator !=(const IndexModel &i) const;
+
+    QJsonObject toJson() const;
+};
+
 class NUT_EXPORT TableModel
 {
 public:
@@ -102,6 +131,7 @@ public:
     FieldModel *field(const QString &name) const;
     RelationModel *foreignKey(const QString &otherTable) const;
     RelationModel *foreignKeyByField(const QString &fieldName) const;
+    IndexModel *index(const QString &name) const;
 
     QString toString() const;
 
@@ -118,8 +148,10 @@ public:
     void setTypeId(const int &typeId);
     QList<FieldModel *> fields() const;
     QList<RelationModel *> foreignKeys() const;
+    QList<IndexModel *> indexes() const;
     QStringList fieldsNames() const;
 
+    bool isFieldsEqual(const TableModel &t) const;
     bool operator ==(const TableModel &t) const;
     bool operator !=(const TableModel &t) const;
 
@@ -129,6 +161,7 @@ private:
     int _typeId;
     QList<FieldModel*> _fields;
     QList<RelationModel*> _foreignKeys;
+    QList<IndexModel*> _indexes;
 };
 
 NUT_END_NAMESPACE
@@ -23,6 +23,7 @@
 #include "tablesetbase_p.h"
 #include "databasemodel.h"
 #include "tablesetbasedata.h"
+#include "rowpool_p.h"
 
 NUT_BEGIN_NAMESPACE
 
@@ -84,6 +85,9 @@ void TableSetBase::clearChilds()
         t->deleteLater();
 #endif
     data->childs.clear();
+
+    // Memory of a large result is not kept for the whole thread lifetime
+    RowPool::trim(__NUT_ROW_POOL_TRIM_SIZE);
 }
 
 void TableSetBase::add(Row<Table> t)
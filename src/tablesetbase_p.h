@@ -60,6 +60,7 @@ public://TODO: change this to private
 
     friend class Table;
     friend class QueryBase;
+    friend class DatabasePrivate;
 };
 
 NUT_END_NAMESPACE
@@ -1,18 +1,95 @@
+/**************************************************************************
+**
+** This file is part of Nut project.
+** https://github.com/HamedMasafi/Nut
+**
+** Nut is free software: you can redistribute it and/or modify
+** it under the terms of the GNU Lesser General Public License as published by
+** the Free Software Foundation, either version 3 of the License, or
+** (at your option) any later version.
+**
+** Nut is distributed in the hope that it will be useful,
+** but WITHOUT ANY WARRANTY; without even the implied warranty of
+** MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+** GNU Lesser General Public License for more details.
+**
+** You should have received a copy of the GNU Lesser General Public License
+** along with Nut.  If not, see <http://www.gnu.org/licenses/>.
+**
+**************************************************************************/
+
 #ifndef TUPLE_H
 #define TUPLE_H
 
-#include <QObject>
+#include <QtCore/QVariant>
+#include <QtSql/QSqlQuery>
+
+#include <cstddef>
+#include <tuple>
+
+#include "defines.h"
+#include "generators/sqlgeneratorbase_p.h"
+
+NUT_BEGIN_NAMESPACE
+
+template<std::size_t... I>
+struct IndexSequence
+{ };
+
+template<std::size_t N, std::size_t... I>
+struct MakeIndexSequence : MakeIndexSequence<N - 1, N - 1, I...>
+{ };
+
+template<std::size_t... I>
+struct MakeIndexSequence<0, I...>
+{
+    typedef IndexSequence<I...> type;
+};
+
+template<typename T>
+inline T fromDatabaseValue(SqlGeneratorBase *generator, const QVariant &v)
+{
+    return generator->unescapeValue(
+                static_cast<QMetaType::Type>(qMetaTypeId<T>()), v)
+            .template value<T>();
+}
+
+template<typename... Ts, std::size_t... I>
+inline std::tuple<Ts...> readTuple(SqlGeneratorBase *generator,
+                                   const QSqlQuery &q, IndexSequence<I...>)
+{
+    return std::tuple<Ts...>(
+                fromDatabaseValue<Ts>(generator, q.value(static_cast<int>(I)))...);
+}
+
+/*
+ * Reads columns of current record of q into a tuple, column i is
+ * converted to i-th type
+ */
+template<typename... Ts>
+inline std::tuple<Ts...> readTuple(SqlGeneratorBase *generator,
+                                   const QSqlQuery &q)
+{
+    return readTuple<Ts...>(generator, q,
+                            typename MakeIndexSequence<sizeof...(Ts)>::type());
+}
+
+template<typename S, typename... Ts, std::size_t... I>
+inline S makeFromTuple(const std::tuple<Ts...> &t, IndexSequence<I...>)
+{
+    return S{ std::get<I>(t)... };
+}
 
-//class AbstractTuple
-//{
-//    Q_GADGET
-//};
+/*
+ * Creates S by aggregate initialization from elements of tuple, members
+ * of S should be in same order of tuple elements
+ */
+template<typename S, typename... Ts>
+inline S makeFromTuple(const std::tuple<Ts...> &t)
+{
+    return makeFromTuple<S>(t, typename MakeIndexSequence<sizeof...(Ts)>::type());
+}
 
-//template <typename T>
-//class Tuple
-//{
-//public:
-//    T _1;
-//};
+NUT_END_NAMESPACE
 
 #endif // TUPLE_H
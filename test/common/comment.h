@@ -17,6 +17,7 @@ class Comment : public Table
 
     NUT_PRIMARY_AUTO_INCREMENT(id)
     NUT_DECLARE_FIELD(int, id, id, setId)
+    NUT_DISPLAY_NAME(message, "Nachricht für Beiträge")
     NUT_DECLARE_FIELD(QString, message, message, setMessage)
     NUT_DECLARE_FIELD(QDateTime, saveDate, saveDate, setSaveDate)
     NUT_DECLARE_FIELD(qreal, point, point, setPoint)
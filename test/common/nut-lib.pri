@@ -10,3 +10,10 @@ INCLUDEPATH += $$PWD/../../src $$PWD/../common
 #include(../../src/src.pri)
 
 DEFINES += NUT_SHARED_POINTER
+
+# Incremental blob I/O of sqlite for BlobStream, QtSql must be built with
+# -system-sqlite so handle of its driver belongs to the linked library
+nut_sqlite_blob {
+    DEFINES += NUT_SQLITE_BLOB
+    LIBS += -lsqlite3
+}
@@ -24,8 +24,10 @@ class Post : public Table
     NUT_LEN(title, 50)
     NUT_DECLARE_FIELD(QString, title, title, setTitle)
 
+    NUT_INDEX(ix_post_saveDate, saveDate, desc)
     NUT_DECLARE_FIELD(QDateTime, saveDate, saveDate, setSaveDate)
 
+    NUT_DEFERRED(body)
     NUT_DECLARE_FIELD(QString, body, body, setBody)
     NUT_DECLARE_FIELD(bool, isPublic, isPublic, setPublic)
 
@@ -2,6 +2,7 @@
 #include <QJsonDocument>
 #include <QSqlError>
 #include <QElapsedTimer>
+#include <thread>
 
 #include "consts.h"
 
@@ -10,6 +11,9 @@
 #include "tableset.h"
 #include "tablemodel.h"
 #include "databasemodel.h"
+#include "sqlmodel.h"
+#include "generators/sqlgeneratorbase_p.h"
+#include "rowpool_p.h"
 
 #include "user.h"
 #include "post.h"
@@ -52,6 +56,18 @@ void BasicTest::dataScheema()
     //    qDebug() << model.toJson();
     //    qDebug() << db.model().toJson();
     //    QTEST_ASSERT(model == db.model());
+
+    // Values of class infos are UTF-8
+    Nut::TableModel *comments = db.model().tableByClassName("Comment");
+    QTEST_ASSERT(comments->field("message")->displayName
+                 == QString::fromUtf8("Nachricht für Beiträge"));
+}
+
+void BasicTest::modelFingerprint()
+{
+    QSqlQuery q = db.exec("SELECT hash FROM __change_logs ORDER BY id DESC");
+    QTEST_ASSERT(q.next());
+    QTEST_ASSERT(q.value(0).toString() == db.model().fingerprint());
 }
 
 void BasicTest::createUser()
@@ -189,6 +205,24 @@ void BasicTest::selectScoreCount()
     QCOMPARE(count, 10);
 }
 
+void BasicTest::selectScoreGroups()
+{
+    auto groups = db.scores()->query()
+            ->groupBy(Score::scoreField())
+            ->having(Nut::count() > 1)
+            ->orderBy(Score::scoreField())
+            ->aggregate(Score::scoreField(),
+                        Nut::count(),
+                        Nut::sum(Score::scoreField()));
+
+    QCOMPARE(groups.count(), 5);
+    for (int i = 0; i < groups.count(); ++i) {
+        QCOMPARE(std::get<0>(groups.at(i)), i);
+        QCOMPARE(std::get<1>(groups.at(i)), 2);
+        QCOMPARE(std::get<2>(groups.at(i)), i * 2);
+    }
+}
+
 void BasicTest::selectFirst()
 {
     auto posts = db.posts()->query()
@@ -214,6 +248,30 @@ qDebug() << ids.count();
     QTEST_ASSERT(ids.count() == 2);
 }
 
+namespace {
+struct PostTitle
+{
+    int id;
+    QString title;
+};
+}
+
+void BasicTest::selectProjection()
+{
+    auto list = db.posts()->query()
+            ->orderBy(Post::idField())
+            ->select(Post::idField(), Post::titleField());
+    QTEST_ASSERT(list.count() == 2);
+    QTEST_ASSERT(std::get<0>(list.first()) == postId);
+
+    auto titles = db.posts()->query()
+            ->where(Post::idField() == postId)
+            ->selectAs<PostTitle>(Post::idField(), Post::titleField());
+    QTEST_ASSERT(titles.count() == 1);
+    QTEST_ASSERT(titles.first().id == postId);
+    QTEST_ASSERT(titles.first().title == std::get<1>(list.first()));
+}
+
 void BasicTest::testDate()
 {
     QDateTime d = QDateTime::currentDateTime();
@@ -288,6 +346,399 @@ void BasicTest::modifyPost()
     QTEST_ASSERT(post->title() == "new name");
 }
 
+void BasicTest::saveGraph()
+{
+    // Posts with same values own different comments
+    QDateTime saveDate = QDateTime::currentDateTime();
+    Nut::RowList<Post> posts;
+    for (int i = 0; i < 3; ++i) {
+        auto newPost = Nut::create<Post>();
+        newPost->setTitle("graph post");
+        newPost->setSaveDate(saveDate);
+        db.posts()->append(newPost);
+
+        for (int j = 0; j < 2; ++j) {
+            auto comment = Nut::create<Comment>();
+            comment->setMessage(QString("graph comment #%1.%2").arg(i).arg(j));
+            comment->setSaveDate(saveDate);
+            comment->setAuthorId(user->id());
+            newPost->comments()->append(comment);
+        }
+        posts.append(newPost);
+    }
+
+    QSignalSpy commands(&db, &Nut::Database::commandExecuted);
+    db.saveChanges();
+
+    // Rows are inserted by one command per table when returned rows are in
+    // order, masters of childs are inserted one by one when they are not
+    // and all rows when their keys can not be returned
+    if (db.sqlGenertor()->supportOrderedReturning())
+        QTEST_ASSERT(commands.count() == 2);
+    else if (db.sqlGenertor()->supportReturning())
+        QTEST_ASSERT(commands.count() == 4);
+    else
+        QTEST_ASSERT(commands.count() == 9);
+
+    for (int i = 0; i < posts.count(); ++i) {
+        Nut::Row<Post> p = posts.at(i);
+        QTEST_ASSERT(p->id() != 0);
+        QTEST_ASSERT(p->status() == Nut::Table::FeatchedFromDB);
+
+        auto comments = db.comments()->query()
+                ->where(Comment::postIdField() == p->id())
+                ->toList();
+        QTEST_ASSERT(comments.count() == 2);
+        foreach (auto c, comments)
+            QTEST_ASSERT(c->message().startsWith(
+                             QString("graph comment #%1.").arg(i)));
+    }
+}
+
+void BasicTest::changedProperties()
+{
+    auto newPost = Nut::create<Post>();
+    QTEST_ASSERT(newPost->changedProperties().isEmpty());
+
+    newPost->setTitle("changed");
+    newPost->setTitle("changed again");
+
+    int titleIndex = newPost->metaObject()->indexOfProperty("title");
+    int bodyIndex = newPost->metaObject()->indexOfProperty("body");
+    QTEST_ASSERT(newPost->isPropertyChanged(titleIndex));
+    QTEST_ASSERT(!newPost->isPropertyChanged(bodyIndex));
+    QTEST_ASSERT(newPost->changedPropertyBits().count(true) == 1);
+    QTEST_ASSERT(newPost->changedProperties() == QSet<QString>() << "title");
+    QTEST_ASSERT(newPost->status() == Nut::Table::Added);
+}
+
+void BasicTest::skipUnchangedUpdate()
+{
+    db.setTrackOriginalValues(true);
+
+    auto row = db.posts()->query()
+            ->where(Post::idField() == postId)
+            ->first();
+    QTEST_ASSERT(row);
+
+    row->setTitle(row->title());
+    QTEST_ASSERT(row->changedProperties().isEmpty());
+    QTEST_ASSERT(db.saveChanges() == 0);
+
+    QString oldTitle = row->title();
+    row->setTitle("changed title");
+    row->setBody(row->body());
+    QTEST_ASSERT(row->changedProperties() == QSet<QString>() << "title");
+
+    row->setTitle(oldTitle);
+    QTEST_ASSERT(row->changedProperties().isEmpty());
+
+    db.setTrackOriginalValues(false);
+}
+
+void BasicTest::selectNoTracking()
+{
+    auto posts = db.posts()->query()
+            ->asNoTracking()
+            ->toList();
+    QTEST_ASSERT(posts.count());
+
+    foreach (Nut::Row<Post> p, posts) {
+        QTEST_ASSERT(!p->parent());
+        QTEST_ASSERT(!p->parentTableSet());
+        QTEST_ASSERT(!p->trackChanges());
+
+        p->setTitle("not saved");
+        QTEST_ASSERT(p->changedProperties().isEmpty());
+        QTEST_ASSERT(p->status() == Nut::Table::FeatchedFromDB);
+    }
+
+#ifndef NUT_SHARED_POINTER
+    qDeleteAll(posts);
+#endif
+}
+
+void BasicTest::compiledQuery()
+{
+    auto byId = db.posts()->query()
+            ->where(Post::idField() == Nut::param<int>("id"))
+            ->compile<int>();
+    QTEST_ASSERT(byId.isValid());
+    QTEST_ASSERT(byId.parameters() == QStringList() << "id");
+
+    auto posts = byId(&db, postId);
+    QTEST_ASSERT(posts.count() == 1);
+    QTEST_ASSERT(posts.first()->id() == postId);
+
+    posts = byId(&db, -1);
+    QTEST_ASSERT(posts.isEmpty());
+
+    // Prepared command is dropped with the connection and prepared again
+    db.close();
+    QTEST_ASSERT(db.open());
+    posts = byId(&db, postId);
+    QTEST_ASSERT(posts.count() == 1);
+}
+
+void BasicTest::pagedModel()
+{
+    int count = db.posts()->query()->count();
+    QTEST_ASSERT(count > 1);
+
+    Nut::SqlModel model(&db, db.posts());
+    model.setPageSize(1);
+    model.setCachedPages(1);
+    db.posts()->query()->toModel(&model);
+
+    QTEST_ASSERT(model.totalCount() == count);
+    QTEST_ASSERT(model.rowCount(QModelIndex()) == 0);
+
+    while (model.canFetchMore(QModelIndex()))
+        model.fetchMore(QModelIndex());
+    QTEST_ASSERT(model.rowCount(QModelIndex()) == count);
+
+    for (int i = 1; i < count; ++i)
+        QTEST_ASSERT(model.at(i - 1)->primaryValue().toInt()
+                     < model.at(i)->primaryValue().toInt());
+
+    db.posts()->query()
+            ->orderBy(!Post::idField())
+            ->toModel(&model);
+    model.fetchMore(QModelIndex());
+    model.fetchMore(QModelIndex());
+    QTEST_ASSERT(model.rowCount(QModelIndex()) == 2);
+    QTEST_ASSERT(model.at(0)->primaryValue().toInt()
+                 > model.at(1)->primaryValue().toInt());
+
+    // Rows with NULL in a sort column are not lost between pages
+    auto noDate = Nut::create<Post>();
+    noDate->setTitle("post without save date");
+    db.posts()->append(noDate);
+    db.saveChanges();
+
+    db.posts()->query()
+            ->orderBy(!Post::saveDateField())
+            ->toModel(&model);
+    while (model.canFetchMore(QModelIndex()))
+        model.fetchMore(QModelIndex());
+    QTEST_ASSERT(model.rowCount(QModelIndex()) == count + 1);
+    QTEST_ASSERT(model.totalCount() == count + 1);
+
+    db.posts()->query()
+            ->where(Post::idField() == noDate->id())
+            ->remove();
+}
+
+void BasicTest::sortAndFilterModel()
+{
+    Nut::TableModel *table = db.model().tableByClassName("Post");
+    int idColumn = table->fields().indexOf(table->field("id"));
+
+    Nut::SqlModel model(&db, db.posts());
+    db.posts()->query()->toModel(&model);
+    model.fetchMore(QModelIndex());
+    QTEST_ASSERT(model.rowCount(QModelIndex()) > 1);
+    int firstId = model.at(0)->primaryValue().toInt();
+
+    model.sort(idColumn, Qt::DescendingOrder);
+    model.fetchMore(QModelIndex());
+    QTEST_ASSERT(model.at(0)->primaryValue().toInt() > firstId);
+
+    model.setFilter(Post::idField() == postId);
+    QTEST_ASSERT(model.totalCount() == 1);
+    model.fetchMore(QModelIndex());
+    QTEST_ASSERT(model.at(0)->primaryValue().toInt() == postId);
+
+    model.setFilter(Nut::ConditionalPhrase());
+    QTEST_ASSERT(model.totalCount() == db.posts()->query()->count());
+}
+
+void BasicTest::refreshModel()
+{
+    Nut::SqlModel model(&db, db.posts());
+    db.posts()->query()->toModel(&model);
+    while (model.canFetchMore(QModelIndex()))
+        model.fetchMore(QModelIndex());
+    int count = model.rowCount(QModelIndex());
+
+    QSignalSpy resetSpy(&model, &QAbstractItemModel::modelReset);
+    QSignalSpy insertSpy(&model, &QAbstractItemModel::rowsInserted);
+    QSignalSpy removeSpy(&model, &QAbstractItemModel::rowsRemoved);
+    QSignalSpy changeSpy(&model, &QAbstractItemModel::dataChanged);
+
+    int id = db.posts()->query()->insert(
+                (Post::titleField() = "refresh")
+                & (Post::isPublicField() = true)).toInt();
+    model.refresh();
+    QTEST_ASSERT(model.rowCount(QModelIndex()) == count + 1);
+    QTEST_ASSERT(insertSpy.count() == 1);
+    QTEST_ASSERT(model.at(count)->primaryValue().toInt() == id);
+
+    db.posts()->query()
+            ->where(Post::idField() == id)
+            ->update(Post::titleField() = "refreshed");
+    model.refresh();
+    QTEST_ASSERT(changeSpy.count() == 1);
+
+    db.posts()->query()->where(Post::idField() == id)->remove();
+    model.refresh();
+    QTEST_ASSERT(model.rowCount(QModelIndex()) == count);
+    QTEST_ASSERT(removeSpy.count() == 1);
+    QTEST_ASSERT(resetSpy.count() == 0);
+}
+
+void BasicTest::modelValueCache()
+{
+    Nut::TableModel *table = db.model().tableByClassName("Post");
+    int titleColumn = table->fields().indexOf(table->field("title"));
+
+    Nut::SqlModel model(&db, db.posts());
+    model.setValueCacheEnabled(true);
+    db.posts()->query()->toModel(&model);
+    model.fetchMore(QModelIndex());
+
+    QModelIndex index = model.index(0, titleColumn);
+    QVariant title = model.data(index, Qt::DisplayRole);
+    QTEST_ASSERT(title == model.at(0)->property("title"));
+
+    // Cached value is shown until rows of model change
+    model.at(0)->setProperty("title", "cached");
+    QTEST_ASSERT(model.data(index, Qt::DisplayRole) == title);
+
+    model.refresh();
+    QTEST_ASSERT(model.data(index, Qt::DisplayRole) == title);
+}
+
+void BasicTest::deferredField()
+{
+    Nut::RowList<Post> newPosts;
+    for (int i = 0; i < 2; ++i) {
+        auto newPost = Nut::create<Post>();
+        newPost->setTitle("deferred");
+        newPost->setBody("deferred body #" + QString::number(i));
+        newPost->setSaveDate(QDateTime::currentDateTime());
+        db.posts()->append(newPost);
+        newPosts.append(newPost);
+    }
+    db.saveChanges();
+
+    auto posts = db.posts()->query()
+            ->where(Post::idField() >= newPosts.first()->id())
+            ->orderBy(Post::idField())
+            ->toList();
+    QTEST_ASSERT(posts.count() == 2);
+
+    int bodyIndex = Post::staticMetaObject.indexOfProperty("body");
+    QTEST_ASSERT(!posts.at(0)->isPropertyLoaded(bodyIndex));
+    QTEST_ASSERT(!posts.at(1)->isPropertyLoaded(bodyIndex));
+    QTEST_ASSERT(posts.at(0)->title() == "deferred");
+
+    // Deferred values are not read back by saving rows
+    Nut::TableModel *table = db.model().tableByClassName("Post");
+    QTEST_ASSERT(!db.sqlGenertor()->returningFields(table).contains("body"));
+    QTEST_ASSERT(newPosts.first()->body() == "deferred body #0");
+
+    // Refreshing a model does not load deferred values
+    Nut::SqlModel model(&db, db.posts());
+    db.posts()->query()
+            ->where(Post::idField() >= newPosts.first()->id())
+            ->toModel(&model);
+    model.fetchMore(QModelIndex());
+    model.refresh();
+    QTEST_ASSERT(model.rowCount(QModelIndex()) == 2);
+    QTEST_ASSERT(!model.at(0)->isPropertyLoaded(bodyIndex));
+
+    // Reading one row loads the other rows of the query too
+    QTEST_ASSERT(posts.at(0)->body() == "deferred body #0");
+    QTEST_ASSERT(posts.at(1)->isPropertyLoaded(bodyIndex));
+    QTEST_ASSERT(posts.at(1)->body() == "deferred body #1");
+    QTEST_ASSERT(posts.at(0)->changedProperties().isEmpty());
+    QTEST_ASSERT(posts.at(1)->status() == Nut::Table::FeatchedFromDB);
+}
+
+void BasicTest::projectedFields()
+{
+    auto newPost = Nut::create<Post>();
+    newPost->setTitle("projected");
+    newPost->setBody("projected body");
+    newPost->setPublic(true);
+    newPost->setSaveDate(QDateTime::currentDateTime());
+    db.posts()->append(newPost);
+    db.saveChanges();
+
+    auto posts = db.posts()->query()
+            ->fields(Post::titleField())
+            ->where(Post::idField() == newPost->id())
+            ->toList();
+    QTEST_ASSERT(posts.count() == 1);
+
+    auto post = posts.first();
+    int publicIndex = post->metaObject()->indexOfProperty("isPublic");
+    QTEST_ASSERT(post->id() == newPost->id());
+    QTEST_ASSERT(post->title() == "projected");
+    QTEST_ASSERT(!post->isPropertyLoaded(publicIndex));
+
+    // Fields out of projection are not overwritten by save
+    post->setTitle("projected title");
+    QTEST_ASSERT(post->changedProperties() == QSet<QString>() << "title");
+    db.saveChanges();
+
+    auto stored = db.posts()->query()
+            ->where(Post::idField() == newPost->id())
+            ->first();
+    QTEST_ASSERT(stored->title() == "projected title");
+    QTEST_ASSERT(stored->isPublic());
+    QTEST_ASSERT(stored->body() == "projected body");
+
+    QTEST_ASSERT(post->isPublic());
+}
+
+namespace {
+// Releases its block while thread local objects of a thread are destroyed
+struct LateRelease {
+    void *block = nullptr;
+    ~LateRelease() { Nut::RowPool::release(block, 40); }
+};
+thread_local LateRelease lateRelease;
+}
+
+void BasicTest::rowPool()
+{
+    void *block = Nut::RowPool::allocate(40);
+    Nut::RowPool::release(block, 40);
+    QTEST_ASSERT(Nut::RowPool::allocate(40) == block);
+
+    // Blocks are freed by other threads, also after their pool is gone
+    void *threadBlock = nullptr;
+    std::thread thread([&]() {
+        lateRelease.block = Nut::RowPool::allocate(40);
+        Nut::RowPool::release(block, 40);
+        threadBlock = Nut::RowPool::allocate(40);
+    });
+    thread.join();
+
+    QTEST_ASSERT(threadBlock == block);
+    Nut::RowPool::release(threadBlock, 40);
+
+    // Kept blocks are freed by trimming and are not kept while disabled
+    QTEST_ASSERT(Nut::Database::isRowPoolEnabled());
+    Nut::Database::trimRowPool();
+    Nut::Database::setRowPoolEnabled(false);
+    QTEST_ASSERT(!Nut::Database::isRowPoolEnabled());
+    block = Nut::RowPool::allocate(40);
+    Nut::RowPool::release(block, 40);
+    Nut::Database::setRowPoolEnabled(true);
+    block = Nut::RowPool::allocate(40);
+    Nut::RowPool::release(block, 40);
+    Nut::RowPool::trim(1);
+    QTEST_ASSERT(Nut::RowPool::allocate(40) == block);
+    Nut::RowPool::release(block, 40);
+
+    auto post = Nut::create<Post>();
+    post->setTitle("pooled");
+    QTEST_ASSERT(post->title() == "pooled");
+}
+
 void BasicTest::emptyDatabase()
 {
 //    auto commentsCount = db.comments()->query()->remove();
@@ -24,6 +24,7 @@ private slots:
     void initTestCase();
 
     void dataScheema();
+    void modelFingerprint();
     void createUser();
     void createPost();
     void createPost2();
@@ -33,14 +34,28 @@ private slots:
     void selectScoreAverage();
     void selectScoreSum();
     void selectScoreCount();
+    void selectScoreGroups();
     void selectFirst();
     void selectPostsWithoutTitle();
     void selectPostIds();
+    void selectProjection();
     void updatePostOnTheFly();
     void testDate();
     void testLimitedQuery();
     void selectWithInvalidRelation();
     void modifyPost();
+    void saveGraph();
+    void changedProperties();
+    void skipUnchangedUpdate();
+    void selectNoTracking();
+    void compiledQuery();
+    void pagedModel();
+    void sortAndFilterModel();
+    void refreshModel();
+    void modelValueCache();
+    void deferredField();
+    void projectedFields();
+    void rowPool();
     void emptyDatabase();
 
     void cleanupTestCase();
@@ -4,6 +4,7 @@
 #include <QList>
 #include <QString>
 #include <QObject>
+#include <QJsonObject>
 
 #include "tablemodel.h"
 #include "generators/sqlitegenerator.h"
@@ -129,6 +130,276 @@ void GeneratorsTest::test_mysql()
     g->deleteLater();
 }
 
+void GeneratorsTest::returning()
+{
+    QStringList fields = QStringList() << "id" << "title";
+
+    Nut::PostgreSqlGenerator psql;
+    QTEST_ASSERT(psql.supportReturning());
+    QTEST_ASSERT(psql.returningPhrase(fields) == "RETURNING id, title");
+    QTEST_ASSERT(psql.outputPhrase(fields).isEmpty());
+
+    Nut::SqlServerGenerator mssql;
+    QTEST_ASSERT(mssql.supportReturning());
+    QTEST_ASSERT(mssql.returningPhrase(fields).isEmpty());
+    QTEST_ASSERT(mssql.outputPhrase(fields)
+                 == "OUTPUT INSERTED.id, INSERTED.title INTO @nut_output");
+
+    // Tables with triggers accept OUTPUT only with INTO
+    QString command = mssql.returningCommand("UPDATE post SET title = 'a' "
+                                             + mssql.outputPhrase(fields)
+                                             + " WHERE id = 1",
+                                             nullptr, fields);
+    QTEST_ASSERT(command.startsWith("SET NOCOUNT ON; DECLARE @nut_output TABLE ("));
+    QTEST_ASSERT(command.contains("; UPDATE post SET title = 'a' OUTPUT "));
+    QTEST_ASSERT(command.endsWith("; SELECT id, title FROM @nut_output"));
+    QTEST_ASSERT(psql.returningCommand("UPDATE post SET title = 'a'",
+                                       nullptr, fields)
+                 == "UPDATE post SET title = 'a'");
+
+    Nut::MySqlGenerator mysql;
+    QTEST_ASSERT(!mysql.supportReturning());
+
+    // Without an open connection sqlite version can not be detected
+    Nut::SqliteGenerator sqlite;
+    QTEST_ASSERT(!sqlite.supportReturning());
+}
+
+void GeneratorsTest::indexes()
+{
+    QJsonObject fields;
+    fields.insert("id", QJsonObject{{"name", "id"}, {"type", "int"}});
+    fields.insert("userId", QJsonObject{{"name", "userId"}, {"type", "int"}});
+    fields.insert("saveDate", QJsonObject{{"name", "saveDate"}, {"type", "QDateTime"}});
+
+    QJsonObject json;
+    json.insert("fields", fields);
+    Nut::TableModel oldTable(json, "post");
+
+    json.insert("indexes", QJsonObject{
+                    {"ix_post_user", QJsonObject{{"fields", "userId, saveDate desc"}}},
+                    {"uq_post_date", QJsonObject{{"fields", "saveDate"},
+                                                 {"unique", true},
+                                                 {"where", "userId > 0"}}}
+                });
+    Nut::TableModel newTable(json, "post");
+
+    QTEST_ASSERT(oldTable.isFieldsEqual(newTable));
+    QTEST_ASSERT(oldTable != newTable);
+    QTEST_ASSERT(Nut::TableModel(newTable.toJson(), "post") == newTable);
+
+    Nut::IndexModel *index = newTable.index("ix_post_user");
+    QTEST_ASSERT(index->fields == QStringList() << "userId" << "saveDate");
+    QTEST_ASSERT(index->fieldsText() == "userId, saveDate desc");
+
+    Nut::PostgreSqlGenerator psql;
+    QStringList drops;
+    QStringList creates;
+    psql.diffIndexes(&oldTable, &newTable, drops, creates);
+    QTEST_ASSERT(drops.isEmpty());
+    QTEST_ASSERT(creates.contains(
+                     "CREATE INDEX ix_post_user ON post (userId, saveDate DESC)"));
+    QTEST_ASSERT(creates.contains(
+                     "CREATE UNIQUE INDEX uq_post_date ON post (saveDate) "
+                     "WHERE userId > 0"));
+
+    drops.clear();
+    creates.clear();
+    psql.diffIndexes(&newTable, &oldTable, drops, creates);
+    QTEST_ASSERT(drops.count() == 2 && creates.isEmpty());
+
+    Nut::MySqlGenerator mysql;
+    QTEST_ASSERT(mysql.dropIndex(&newTable, index)
+                 == "DROP INDEX ix_post_user ON post");
+}
+
+void GeneratorsTest::foreignKeys()
+{
+    QJsonObject fields;
+    fields.insert("id", QJsonObject{{"name", "id"}, {"type", "int"}});
+    fields.insert("postId", QJsonObject{{"name", "postId"}, {"type", "int"}});
+
+    QJsonObject json;
+    json.insert("fields", fields);
+    json.insert("foreign_keys", QJsonObject{
+                    {"postId", QJsonObject{{"localColumn", "postId"},
+                                           {"localProperty", "post"},
+                                           {"masterClassName", "Post"},
+                                           {"foreignColumn", "id"}}}
+                });
+    Nut::TableModel oldTable(json, "comment");
+
+    json.insert("foreign_keys", QJsonObject{
+                    {"postId", QJsonObject{{"localColumn", "postId"},
+                                           {"localProperty", "post"},
+                                           {"masterClassName", "Post"},
+                                           {"foreignColumn", "id"},
+                                           {"constraint", true},
+                                           {"onDelete", "CASCADE"}}}
+                });
+    Nut::TableModel newTable(json, "comment");
+    Nut::TableModel postTable(QJsonObject{{"fields", QJsonObject{}}}, "post");
+    newTable.foreignKeyByField("postId")->masterTable = &postTable;
+
+    QTEST_ASSERT(oldTable.foreignKeyByField("postId")->slaveTable == &oldTable);
+    QTEST_ASSERT(oldTable != newTable);
+
+    Nut::PostgreSqlGenerator psql;
+    QStringList drops;
+    QStringList creates;
+    psql.diffRelation(&oldTable, &newTable, drops, creates);
+    QTEST_ASSERT(drops.isEmpty());
+    QTEST_ASSERT(creates == QStringList()
+                 << "ALTER TABLE comment ADD CONSTRAINT fk_comment_postId "
+                    "FOREIGN KEY (postId) REFERENCES post(id) ON DELETE CASCADE");
+
+    drops.clear();
+    creates.clear();
+    Nut::MySqlGenerator mysql;
+    mysql.diffRelation(&newTable, &oldTable, drops, creates);
+    QTEST_ASSERT(creates.isEmpty());
+    QTEST_ASSERT(drops == QStringList()
+                 << "ALTER TABLE comment DROP FOREIGN KEY fk_comment_postId");
+
+    // Sqlite keeps constraints inside of table, so table is rebuilt
+    Nut::SqliteGenerator sqlite;
+    QTEST_ASSERT(sqlite.constraints(&newTable).count() == 1);
+    QTEST_ASSERT(sqlite.diff(&oldTable, &newTable).count() > 1);
+}
+
+void GeneratorsTest::sqliteAlterTable()
+{
+    QJsonObject fields;
+    fields.insert("id", QJsonObject{{"name", "id"}, {"type", "int"}});
+    fields.insert("title", QJsonObject{{"name", "title"}, {"type", "QString"}});
+    Nut::TableModel oldTable(QJsonObject{{"fields", fields}}, "post");
+
+    fields.insert("body", QJsonObject{{"name", "body"}, {"type", "QString"}});
+    Nut::TableModel addedTable(QJsonObject{{"fields", fields}}, "post");
+
+    fields.remove("title");
+    Nut::TableModel droppedTable(QJsonObject{{"fields", fields}}, "post");
+
+    // Without an open connection only ADD COLUMN is known to be supported
+    Nut::SqliteGenerator sqlite;
+    QTEST_ASSERT(sqlite.diff(&oldTable, &addedTable)
+                 == QStringList() << "ALTER TABLE post ADD COLUMN body TEXT");
+    QTEST_ASSERT(sqlite.diff(&oldTable, &oldTable).isEmpty());
+
+    // Table is created aside and renamed, so references of child tables
+    // are kept
+    QStringList rebuild = sqlite.diff(&oldTable, &droppedTable);
+    QTEST_ASSERT(rebuild.count() == 6);
+    QTEST_ASSERT(rebuild.at(0) == "PRAGMA foreign_keys=OFF");
+    QTEST_ASSERT(rebuild.at(1).startsWith("CREATE TABLE nut_rebuild_post "));
+    QTEST_ASSERT(rebuild.at(2).startsWith("INSERT INTO nut_rebuild_post ("));
+    QTEST_ASSERT(rebuild.at(2).endsWith(" FROM post"));
+    QTEST_ASSERT(rebuild.at(3) == "DROP TABLE post");
+    QTEST_ASSERT(rebuild.at(4) == "ALTER TABLE nut_rebuild_post RENAME TO post");
+    QTEST_ASSERT(rebuild.at(5) == "PRAGMA foreign_key_check(post)");
+}
+
+void GeneratorsTest::copyRecords()
+{
+    Nut::SqliteGenerator sqlite;
+    QString copy = sqlite.copyRecords("nut_rebuild_post", "post",
+                                      QStringList() << "id" << "title",
+                                      QStringList() << "id" << "name");
+    QTEST_ASSERT(copy == "INSERT INTO nut_rebuild_post ( id, title ) "
+                         "SELECT id, name FROM post");
+
+    QString tableName;
+    QString fromTable;
+    QTEST_ASSERT(sqlite.isCopyRecords(copy, tableName, fromTable));
+    QTEST_ASSERT(tableName == "nut_rebuild_post");
+    QTEST_ASSERT(fromTable == "post");
+    QTEST_ASSERT(!sqlite.isCopyRecords("DROP TABLE post", tableName, fromTable));
+
+    // Renamed key is filtered by its old column
+    QStringList fields;
+    QStringList fromFields;
+    QString renamed = sqlite.copyRecords("nut_rebuild_post", "post",
+                                         QStringList() << "post_id" << "title",
+                                         QStringList() << "id" << "name");
+    QTEST_ASSERT(sqlite.isCopyRecords(renamed, tableName, fromTable,
+                                      fields, fromFields));
+    QTEST_ASSERT(fields == QStringList() << "post_id" << "title");
+    QTEST_ASSERT(fromFields == QStringList() << "id" << "name");
+    QTEST_ASSERT(fromFields.at(fields.indexOf("post_id")) == "id");
+
+    QTEST_ASSERT(sqlite.copyRecordsChunk(copy, "id", QVariant(), 100)
+                 == copy + " ORDER BY id LIMIT 100");
+    QTEST_ASSERT(sqlite.copyRecordsChunk(copy, "id", 250, 100)
+                 == copy + " WHERE id > 250 ORDER BY id LIMIT 100");
+}
+
+void GeneratorsTest::unescapeNativeValues()
+{
+    Nut::SqliteGenerator sqlite;
+    QVariant v;
+
+    v = sqlite.unescapeValue(QMetaType::Int, QVariant(qlonglong(42)));
+    QTEST_ASSERT(v.userType() == QMetaType::Int && v.toInt() == 42);
+
+    v = sqlite.unescapeValue(QMetaType::Double, QVariant(QStringLiteral("2.5")));
+    QTEST_ASSERT(v.userType() == QMetaType::Double && v.toDouble() == 2.5);
+
+    v = sqlite.unescapeValue(QMetaType::Bool, QVariant(1));
+    QTEST_ASSERT(v.userType() == QMetaType::Bool && v.toBool());
+
+    v = sqlite.unescapeValue(QMetaType::QString, QVariant(QStringLiteral("text")));
+    QTEST_ASSERT(v == QStringLiteral("text"));
+
+    QVariant out;
+    QTEST_ASSERT(!sqlite.unescapeNativeValue(QMetaType::QByteArray,
+                                             QVariant(QByteArray("AAE=")), out));
+    QTEST_ASSERT(!sqlite.unescapeNativeValue(QMetaType::QPoint,
+                                             QVariant(QStringLiteral("1,2")), out));
+}
+
+void GeneratorsTest::binaryParameters()
+{
+    QByteArray blob("\x00\x01\x02", 3);
+    QList<QVariantList> vars;
+    vars.append(QVariantList() << 1 << blob);
+
+    Nut::SqliteGenerator sqlite;
+    QVariantMap binds;
+    QString sql = sqlite.insertRecords("post", QStringList() << "id" << "data",
+                                       vars, QStringList(), &binds);
+    QTEST_ASSERT(sql.endsWith(", :nut_bind_0)"));
+    QTEST_ASSERT(binds.count() == 1);
+
+    // Buffer of byte array is shared, not copied
+    QTEST_ASSERT(binds.value(":nut_bind_0").toByteArray().constData()
+                 == blob.constData());
+
+    QVariant out;
+    QTEST_ASSERT(sqlite.unescapeNativeValue(QMetaType::QByteArray,
+                                            QVariant(blob), out));
+    QTEST_ASSERT(out.toByteArray() == blob);
+
+    Nut::MySqlGenerator mysql;
+    binds.clear();
+    mysql.insertRecords("post", QStringList() << "id" << "data",
+                        vars, QStringList(), &binds);
+    QTEST_ASSERT(binds.isEmpty());
+}
+
+void GeneratorsTest::blobCommands()
+{
+    Nut::SqliteGenerator sqlite;
+    QTEST_ASSERT(sqlite.blobLength("post", "data", "id")
+                 == "SELECT LENGTH(data) FROM post WHERE id = :key");
+    QTEST_ASSERT(sqlite.blobRead("post", "data", "id")
+                 == "SELECT substr(data, :offset, :length) FROM post WHERE id = :key");
+    QTEST_ASSERT(sqlite.blobAppend("post", "data", "id")
+                 == "UPDATE post SET data = CAST(COALESCE(data, X'') || :chunk AS BLOB) "
+                    "WHERE id = :key");
+    QTEST_ASSERT(sqlite.blobClear("post", "data", "id")
+                 == "UPDATE post SET data = :chunk WHERE id = :key");
+}
+
 void GeneratorsTest::cleanupTestCase()
 {
     QMap<QString, row>::const_iterator i;
@@ -41,6 +41,15 @@ private slots:
     void test_sqlserver();
     void test_mysql();
 
+    void returning();
+    void indexes();
+    void foreignKeys();
+    void sqliteAlterTable();
+    void copyRecords();
+    void unescapeNativeValues();
+    void binaryParameters();
+    void blobCommands();
+
     void cleanupTestCase();
 
 };
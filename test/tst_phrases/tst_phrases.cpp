@@ -126,6 +126,26 @@ void PhrasesTest::mix()
     order_by(id | !name);
 }
 
+void PhrasesTest::shared()
+{
+    FieldPhrase<int> id("main", "id");
+
+    ConditionalPhrase p1 = id == 1;
+    ConditionalPhrase p2 = !p1;
+    QTEST_ASSERT(!p1.data->isNot);
+    QTEST_ASSERT(p2.data->isNot);
+    QTEST_ASSERT(p2.data->left == p1.data->left);
+
+    ConditionalPhrase p3 = p1 && p1;
+    ConditionalPhrase p4;
+    p4 = p3;
+    p4 = p1;
+    QTEST_ASSERT(p3.data->left == p1.data);
+    QTEST_ASSERT(p3.data->right == p1.data);
+    QTEST_ASSERT(p1.data->parents.load() == 4);
+    QTEST_ASSERT(p3.data->parents.load() == 1);
+}
+
 void PhrasesTest::select(const PhraseList &ph)
 {
     QTEST_ASSERT(ph.data.count());
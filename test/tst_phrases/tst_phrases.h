@@ -31,6 +31,7 @@ private slots:
     void datetime();
     void extra();
     void mix();
+    void shared();
 
 private:
     void select(const Nut::PhraseList &ph);
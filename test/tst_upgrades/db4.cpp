@@ -0,0 +1,9 @@
+#include "db4.h"
+
+#include "table2.h"
+
+DB4::DB4() : Nut::Database (),
+    m_sampleTable(new Nut::TableSet<Table2>(this))
+{
+
+}
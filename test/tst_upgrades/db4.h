@@ -0,0 +1,22 @@
+#ifndef DB4_H
+#define DB4_H
+
+#include "database.h"
+
+class Table2;
+
+class DB4 : public Nut::Database
+{
+    Q_OBJECT
+
+    NUT_DB_VERSION(1)
+
+    NUT_DECLARE_TABLE(Table2, sampleTable)
+
+public:
+    DB4();
+};
+
+Q_DECLARE_METATYPE(DB4*)
+
+#endif // DB4_H
@@ -0,0 +1,9 @@
+#include "db5.h"
+
+#include "table1.h"
+
+DB5::DB5() : Nut::Database (),
+    m_sampleTable(new Nut::TableSet<Table1>(this))
+{
+
+}
@@ -0,0 +1,22 @@
+#ifndef DB5_H
+#define DB5_H
+
+#include "database.h"
+
+class Table1;
+
+class DB5 : public Nut::Database
+{
+    Q_OBJECT
+
+    NUT_DB_VERSION(1)
+
+    NUT_DECLARE_TABLE(Table1, sampleTable)
+
+public:
+    DB5();
+};
+
+Q_DECLARE_METATYPE(DB5*)
+
+#endif // DB5_H
@@ -1,8 +1,14 @@
 #include <QtTest>
+#include <QSqlRecord>
+#include <QSqlQuery>
+#include <QJsonDocument>
+#include <QJsonObject>
 
 #include "db1.h"
 #include "db2.h"
 #include "db3.h"
+#include "db4.h"
+#include "db5.h"
 
 #include "table1.h"
 #include "table2.h"
@@ -38,6 +44,8 @@ void Upgrades::initTestCase()
     REGISTER(DB1);
     REGISTER(DB2);
     REGISTER(DB3);
+    REGISTER(DB4);
+    REGISTER(DB5);
 
     REGISTER(Table1);
     REGISTER(Table2);
@@ -52,6 +60,53 @@ void Upgrades::version1()
     db.sampleTable()->query()->remove();
 }
 
+void Upgrades::changeLogsWithoutHash()
+{
+    if (QLatin1String(DRIVER) != QLatin1String("QSQLITE"))
+        QSKIP("Change logs are rewritten with sqlite");
+
+    // Rewrite change logs of DB1 like older versions stored them, without
+    // hash column and its index
+    {
+        QSqlDatabase raw = QSqlDatabase::addDatabase(DRIVER, "change_logs");
+        raw.setDatabaseName(DATABASE);
+        QTEST_ASSERT(raw.open());
+
+        QSqlQuery q = raw.exec("SELECT data, version FROM __change_logs "
+                               "ORDER BY id DESC LIMIT 1");
+        QTEST_ASSERT(q.next());
+        QJsonObject json = QJsonDocument::fromJson(q.value(0).toByteArray()).object();
+        int version = q.value(1).toInt();
+        q.finish();
+
+        QJsonObject tables = json.value("tables").toObject();
+        QJsonObject changeLogs = tables.value("__change_logs").toObject();
+        QJsonObject fields = changeLogs.value("fields").toObject();
+        fields.remove("hash");
+        changeLogs.insert("fields", fields);
+        changeLogs.remove("indexes");
+        tables.insert("__change_logs", changeLogs);
+        json.insert("tables", tables);
+
+        raw.exec("DROP TABLE __change_logs");
+        raw.exec("CREATE TABLE __change_logs (id INTEGER PRIMARY KEY "
+                 "AUTOINCREMENT, data TEXT, version INTEGER)");
+        q = QSqlQuery(raw);
+        q.prepare("INSERT INTO __change_logs (data, version) VALUES (:data, :version)");
+        q.bindValue(":data", QString(QJsonDocument(json).toJson(QJsonDocument::Compact)));
+        q.bindValue(":version", version);
+        QTEST_ASSERT(q.exec());
+        raw.close();
+    }
+    QSqlDatabase::removeDatabase("change_logs");
+
+    DB2 db;
+    initDb(db);
+    QTEST_ASSERT(db.open());
+    QTEST_ASSERT(db.database().record("__change_logs").contains("hash"));
+    QTEST_ASSERT(db.database().record("sampleTable").contains("grade"));
+}
+
 void Upgrades::version2()
 {
     DB2 db;
@@ -76,6 +131,36 @@ void Upgrades::version3()
     QTEST_ASSERT(id == t->id());
 }
 
+void Upgrades::interruptedMigration()
+{
+    // Migration to DB4 rebuilds sampleTable, connection is lost after its
+    // third step that copies rows into the new table
+    {
+        DB4 db;
+        initDb(db);
+        connect(&db, &Nut::Database::migrationProgress,
+                [&db](int step, int, qint64, qint64) {
+            if (step == 3)
+                db.database().close();
+        });
+        db.open();
+    }
+
+    // Reopening continues migration to DB4 and then changes it to DB5
+    DB5 db;
+    initDb(db);
+    QTEST_ASSERT(db.open());
+    QTEST_ASSERT(!db.database().tables().contains("__migration_journal"));
+
+    QSqlRecord record = db.database().record("sampleTable");
+    QTEST_ASSERT(record.count() == 1);
+    QTEST_ASSERT(record.contains("id"));
+
+    auto t = db.sampleTable()->query()
+            ->first();
+    QTEST_ASSERT(id == t->id());
+}
+
 void Upgrades::cleanupTestCase()
 {
     DB1 db;
@@ -21,8 +21,10 @@ private slots:
     void initTestCase();
 
     void version1();
+    void changeLogsWithoutHash();
     void version2();
     void version3();
+    void interruptedMigration();
 
     void cleanupTestCase();
 
@@ -12,7 +12,9 @@ SOURCES +=  tst_upgrades.cpp \
     db2.cpp \
     table2.cpp \
     db3.cpp \
-    table3.cpp
+    table3.cpp \
+    db4.cpp \
+    db5.cpp
 
 HEADERS += \
     tst_upgrades.h \
@@ -21,6 +23,8 @@ HEADERS += \
     db2.h \
     table2.h \
     db3.h \
-    table3.h
+    table3.h \
+    db4.h \
+    db5.h
 
 include($$PWD/../../ci-test-init.pri)